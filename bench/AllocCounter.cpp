@@ -0,0 +1,86 @@
+
+#include "BenchUtils.h"
+
+#include <QAtomicInteger>
+
+#include <cstdlib>
+#include <new>
+
+/**
+ * @file Counts heap allocations made by the benchmarked code. With glibc the C
+ * allocator itself is wrapped, which catches Qt's containers as they allocate
+ * through `malloc`. Elsewhere only the global `operator new` is replaced.
+ */
+
+static QBasicAtomicInteger<quint64> s_allocations = Q_BASIC_ATOMIC_INITIALIZER(0);
+
+#if defined(__GLIBC__)
+
+extern "C" {
+
+void *__libc_malloc(std::size_t size);
+void *__libc_calloc(std::size_t count, std::size_t size);
+void *__libc_realloc(void *ptr, std::size_t size);
+
+void *malloc(std::size_t size)
+{
+    s_allocations.fetchAndAddRelaxed(1);
+
+    return __libc_malloc(size);
+}
+
+void *calloc(std::size_t count, std::size_t size)
+{
+    s_allocations.fetchAndAddRelaxed(1);
+
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, std::size_t size)
+{
+    s_allocations.fetchAndAddRelaxed(1);
+
+    return __libc_realloc(ptr, size);
+}
+
+} // extern "C"
+
+#else
+
+void *operator new(std::size_t size)
+{
+    s_allocations.fetchAndAddRelaxed(1);
+
+    void *ptr = std::malloc(size ? size : 1);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+
+    return ptr;
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+#endif
+
+namespace benchUtils {
+
+quint64 allocations()
+{
+    return s_allocations.load();
+}
+
+} // end namespace benchUtils
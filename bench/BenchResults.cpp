@@ -0,0 +1,40 @@
+
+#include "BenchUtils.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+
+namespace benchUtils {
+
+static QJsonArray s_results;
+
+void record(const QString &name, const double nsOp, const double allocsOp)
+{
+    QJsonObject result;
+    result["name"] = name;
+    result["nsPerOp"] = nsOp;
+    result["allocsPerOp"] = allocsOp >= 0 ? QJsonValue(allocsOp) : QJsonValue();
+
+    s_results.append(result);
+}
+
+bool writeJsonResults(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+
+    QJsonObject root;
+    root["qtVersion"] = QString(qVersion());
+    root["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    root["results"] = s_results;
+
+    return file.write(QJsonDocument(root).toJson(QJsonDocument::Indented)) >= 0;
+}
+
+} // end namespace benchUtils
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2014 Kevin Brightwell <kevin.brightwell2@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef BENCHUTILS_H
+#define BENCHUTILS_H
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QTextStream>
+
+#include <cstdio>
+
+/**
+ * @file Small helpers shared by the benchmarks, each suite is a function
+ * declared here and run from main.cpp.
+ */
+
+namespace benchUtils {
+
+/**
+ * Runs `func` `iterations` times, after a short warm up, and returns the mean
+ * time of a single call in nanoseconds.
+ */
+template <typename F>
+double nsPerOp(F func, const int iterations)
+{
+    for (int i = 0; i < iterations / 10 + 1; ++i) {
+        func();
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < iterations; ++i) {
+        func();
+    }
+
+    return double(timer.nsecsElapsed()) / iterations;
+}
+
+/**
+ * Number of heap allocations so far, counted by AllocCounter.cpp. With glibc
+ * that is every `malloc`, `calloc` and `realloc`, Qt's own container data
+ * included; elsewhere only calls to the global `operator new`.
+ */
+quint64 allocations();
+
+/**
+ * Runs `func` `iterations` times, after a warm up call, and returns the mean
+ * number of heap allocations made by a single call.
+ */
+template <typename F>
+double allocsPerOp(F func, const int iterations)
+{
+    func();
+
+    const quint64 before = allocations();
+
+    for (int i = 0; i < iterations; ++i) {
+        func();
+    }
+
+    return double(allocations() - before) / iterations;
+}
+
+/**
+ * Keeps a result for writeJsonResults(), called by report().
+ */
+void record(const QString &name, const double nsOp, const double allocsOp);
+
+/**
+ * Writes every result reported so far to `fileName` as JSON, so runs can be
+ * compared release to release:
+ *
+ *     {"qtVersion": "5.4.1", "timestamp": "...",
+ *      "results": [{"name": "...", "nsPerOp": 12.5, "allocsPerOp": 0}, ...]}
+ *
+ * `allocsPerOp` is null where it was not measured.
+ */
+bool writeJsonResults(const QString &fileName);
+
+/**
+ * Prints a single result line, `name` is padded so results line up.
+ * `allocsOp` is left out if negative.
+ */
+inline
+void report(const QString &name, const double nsOp, const double allocsOp = -1)
+{
+    record(name, nsOp, allocsOp);
+
+    QTextStream out(stdout);
+    out << name.leftJustified(60) << QString::number(nsOp, 'f', 1).rightJustified(12) << " ns/op";
+
+    if (allocsOp >= 0) {
+        out << QString::number(allocsOp, 'f', 2).rightJustified(10) << " allocs/op";
+    }
+
+    out << '\n';
+}
+
+//!< Compares QWebRouteIndex strategies with a linear scan
+void routeIndexSuite();
+
+//!< Measures QWebRouteFactory::create and createRegex for routes of each kind
+void routeFactorySuite();
+
+//!< Measures QWebRoute::checkPath for hits and misses of each kind of route
+void checkPathSuite();
+
+//!< Measures QWebRouter::findRoute on tables of 10 to 10000 routes, including
+//!< allocations
+void routerSuite();
+
+//!< Measures what QWebRouter::handleRoute does for a request short of the
+//!< socket: routing, the request and response objects, middleware and handler
+void dispatchSuite();
+
+//!< Measures what counting a response in QWebMetrics adds to a request, and
+//!< exporting the counters
+void metricsSuite();
+
+//!< Compares response size and time of the JSON serialization options
+void jsonSuite();
+
+//!< Measures connection throughput of the worker pool against SO_REUSEPORT
+//!< listeners as the number of worker threads grows, Linux only
+void acceptSuite();
+
+} // end namespace benchUtils
+
+#endif // BENCHUTILS_H
@@ -0,0 +1,271 @@
+
+#include "LoadGenerator.h"
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QVector>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace benchUtils {
+
+double LoadResult::percentileUsec(const double fraction) const
+{
+    if (latencies.empty()) {
+        return 0;
+    }
+
+    const size_t index = std::min(latencies.size() - 1, size_t(fraction * latencies.size()));
+
+    return latencies[index] / 1000.0;
+}
+
+QByteArray buildRequest(const QByteArray &method, const QByteArray &path,
+                        const QByteArray &body, const QByteArray &contentType)
+{
+    QByteArray request = method + ' ' + path + " HTTP/1.1\r\n"
+            "Host: localhost\r\n"
+            "Connection: keep-alive\r\n";
+
+    if (!body.isEmpty()) {
+        request += "Content-Type: " + contentType + "\r\n"
+                   "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    }
+
+    return request + "\r\n" + body;
+}
+
+/**
+ * Length of the complete response at the start of `buffer`, 0 if more is
+ * needed and -1 if it can not be read. Understands `Content-Length` and
+ * chunked bodies, which is all %QHttpResponse sends.
+ */
+static
+int responseLength(const QByteArray &buffer, int *status, bool *close)
+{
+    const int headerEnd = buffer.indexOf("\r\n\r\n");
+    if (headerEnd < 0) {
+        return 0;
+    }
+
+    const QByteArray head = buffer.left(headerEnd).toLower();
+    const int bodyStart = headerEnd + 4;
+
+    // "http/1.1 200 ok"
+    bool ok = false;
+    *status = head.mid(9, 3).toInt(&ok);
+    if (!ok) {
+        return -1;
+    }
+
+    *close = head.contains("\r\nconnection: close");
+
+    const int lengthAt = head.indexOf("\r\ncontent-length:");
+    if (lengthAt >= 0) {
+        const int valueAt = lengthAt + 17;
+        const int valueEnd = head.indexOf("\r\n", valueAt);
+        const int length = head.mid(valueAt, valueEnd < 0 ? -1 : valueEnd - valueAt).trimmed().toInt(&ok);
+        if (!ok) {
+            return -1;
+        }
+
+        return buffer.size() >= bodyStart + length ? bodyStart + length : 0;
+    }
+
+    if (!head.contains("\r\ntransfer-encoding: chunked")) {
+        return bodyStart;
+    }
+
+    int pos = bodyStart;
+    forever {
+        const int lineEnd = buffer.indexOf("\r\n", pos);
+        if (lineEnd < 0) {
+            return 0;
+        }
+
+        QByteArray sizeLine = buffer.mid(pos, lineEnd - pos);
+        const int extension = sizeLine.indexOf(';');
+        if (extension >= 0) {
+            sizeLine.truncate(extension);
+        }
+
+        const int size = sizeLine.trimmed().toInt(&ok, 16);
+        if (!ok) {
+            return -1;
+        }
+
+        pos = lineEnd + 2;
+
+        if (size == 0) {
+            // no trailers are sent, only the final empty line
+            return buffer.size() >= pos + 2 ? pos + 2 : 0;
+        }
+
+        pos += size + 2;
+        if (pos > buffer.size()) {
+            return 0;
+        }
+    }
+}
+
+/**
+ * Sends requests from `schedule` on a single connection until `stop` is set.
+ */
+static
+void runConnection(const QHostAddress &address, const quint16 port, const LoadOptions &options,
+                   const QVector<QByteArray> &schedule, const int first,
+                   const QAtomicInt *stop, LoadResult *result)
+{
+    QTcpSocket socket;
+    QByteArray buffer;
+    int next = first;
+
+    while (stop->load() == 0) {
+        if (socket.state() != QAbstractSocket::ConnectedState) {
+            buffer.clear();
+            socket.abort();
+            socket.connectToHost(address, port);
+
+            if (!socket.waitForConnected(options.timeoutMsec)) {
+                ++result->errors;
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                continue;
+            }
+        }
+
+        for (int i = 0; i < options.pipeline; ++i) {
+            socket.write(schedule[next]);
+            next = (next + 1) % schedule.size();
+        }
+
+        QElapsedTimer sent;
+        sent.start();
+
+        int pending = options.pipeline;
+        while (pending > 0) {
+            if (socket.bytesToWrite() > 0) {
+                socket.waitForBytesWritten(options.timeoutMsec);
+            }
+
+            int status = 0;
+            bool close = false;
+            const int length = responseLength(buffer, &status, &close);
+
+            if (length > 0) {
+                buffer.remove(0, length);
+                result->latencies.push_back(sent.nsecsElapsed());
+                ++result->responses;
+                ++result->statusClasses[qBound(0, status / 100, 5)];
+                --pending;
+
+                if (close) {
+                    // whatever else was pipelined is lost with the connection
+                    result->errors += pending;
+                    socket.abort();
+                    break;
+                }
+                continue;
+            }
+
+            if (length < 0 || !socket.waitForReadyRead(options.timeoutMsec)) {
+                result->errors += pending;
+                socket.abort();
+                break;
+            }
+
+            buffer += socket.readAll();
+        }
+    }
+}
+
+LoadResult runLoad(const QHostAddress &address, const quint16 port, const LoadOptions &options)
+{
+    int totalWeight = 0;
+    for (const QPair<QByteArray, int> &request : options.mix) {
+        totalWeight += qMax(0, request.second);
+    }
+
+    if (totalWeight == 0 || options.connections <= 0 || options.pipeline <= 0) {
+        return LoadResult();
+    }
+
+    // requests in proportion to their weight, interleaved so a connection
+    // sees the whole mix
+    QVector<QByteArray> schedule;
+    for (int round = 0; schedule.size() < 1000; ++round) {
+        bool added = false;
+        for (const QPair<QByteArray, int> &request : options.mix) {
+            if (round < request.second) {
+                schedule += request.first;
+                added = true;
+            }
+        }
+
+        if (!added) {
+            round = -1;
+        }
+    }
+
+    QAtomicInt stop(0);
+    QAtomicInt running(options.connections);
+
+    std::vector<LoadResult> results(options.connections);
+    std::vector<std::thread> threads;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int c = 0; c < options.connections; ++c) {
+        LoadResult *result = &results[c];
+        const int first = (c * 97) % schedule.size();
+
+        threads.emplace_back([&, result, first]() {
+            runConnection(address, port, options, schedule, first, &stop, result);
+            running.deref();
+        });
+    }
+
+    // the service under test may live on this thread, keep its event loop
+    // going until every connection is done
+    QEventLoop loop;
+    QTimer poll;
+    QObject::connect(&poll, &QTimer::timeout, [&]() {
+        if (timer.elapsed() >= options.durationMsec) {
+            stop.store(1);
+        }
+
+        if (running.load() == 0) {
+            loop.quit();
+        }
+    });
+    poll.start(5);
+    loop.exec();
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    LoadResult total;
+    total.seconds = timer.nsecsElapsed() / 1e9;
+
+    for (const LoadResult &result : results) {
+        total.responses += result.responses;
+        total.errors += result.errors;
+        for (int i = 0; i < 6; ++i) {
+            total.statusClasses[i] += result.statusClasses[i];
+        }
+
+        total.latencies.insert(total.latencies.end(), result.latencies.begin(), result.latencies.end());
+    }
+
+    std::sort(total.latencies.begin(), total.latencies.end());
+
+    return total;
+}
+
+} // end namespace benchUtils
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2014 Kevin Brightwell <kevin.brightwell2@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef LOADGENERATOR_H
+#define LOADGENERATOR_H
+
+#include <QByteArray>
+#include <QHostAddress>
+#include <QList>
+#include <QPair>
+#include <QString>
+
+#include <vector>
+
+/**
+ * @file A small HTTP/1.1 load generator for qwebservice-load. Every
+ * connection runs on its own thread with blocking sockets, so the server
+ * under test keeps the event loop of the calling thread to itself.
+ */
+
+namespace benchUtils {
+
+/**
+ * Options of a load run.
+ */
+class LoadOptions {
+public:
+
+    LoadOptions()
+        : connections(16),
+          pipeline(1),
+          durationMsec(3000),
+          timeoutMsec(5000) {
+
+    }
+
+    //!< Keep-alive connections, each on its own thread
+    int connections;
+
+    //!< Requests written on a connection before reading their responses
+    int pipeline;
+
+    //!< How long requests are sent for
+    int durationMsec;
+
+    //!< A response not complete after this counts as an error, the
+    //!< connection is then opened again
+    int timeoutMsec;
+
+    //!< Raw requests and their weight in the mix, the `Host` header and
+    //!< keep-alive are up to the caller
+    QList<QPair<QByteArray, int> > mix;
+};
+
+/**
+ * Outcome of a load run.
+ */
+class LoadResult {
+public:
+
+    LoadResult()
+        : responses(0),
+          errors(0),
+          seconds(0) {
+
+        for (quint64 &count : statusClasses) {
+            count = 0;
+        }
+    }
+
+    //!< Complete responses read, of any status
+    quint64 responses;
+
+    //!< Timeouts, refused connections and responses that could not be read
+    quint64 errors;
+
+    //!< Responses per status code class, index 1 to 5 for 1xx to 5xx
+    quint64 statusClasses[6];
+
+    //!< Length of the run
+    double seconds;
+
+    //!< Latency of every response in nanoseconds, sorted. With pipelining
+    //!< it is measured from when its batch was written.
+    std::vector<qint64> latencies;
+
+    inline
+    double requestsPerSecond() const {
+        return seconds > 0 ? responses / seconds : 0;
+    }
+
+    /**
+     * Latency below which `fraction` of the responses were, in microseconds.
+     */
+    double percentileUsec(const double fraction) const;
+};
+
+/**
+ * Sends the requests of `options.mix` to `address`:`port` until the duration
+ * passed. Blocks, the thread's event loop keeps running meanwhile so a
+ * service on it can answer.
+ */
+LoadResult runLoad(const QHostAddress &address, const quint16 port, const LoadOptions &options);
+
+/**
+ * Builds a keep-alive request, with a `Content-Length` if there is a body.
+ */
+QByteArray buildRequest(const QByteArray &method, const QByteArray &path,
+                        const QByteArray &body = QByteArray(),
+                        const QByteArray &contentType = "application/octet-stream");
+
+} // end namespace benchUtils
+
+#endif // LOADGENERATOR_H
@@ -0,0 +1,114 @@
+
+#include "BenchUtils.h"
+
+#include "QWebService.h"
+#include "QWebServiceConfig.h"
+#include "router/QWebResponse.h"
+
+#include <QAtomicInt>
+#include <QEventLoop>
+#include <QScopedPointer>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
+
+#include <thread>
+#include <vector>
+
+namespace benchUtils {
+
+/**
+ * Opens `count` connections one after the other, each sending a single
+ * request and reading the response until the server closes it.
+ */
+static
+void runClient(const quint16 port, const int count, QAtomicInt *failures)
+{
+    static const QByteArray request = "GET /ping HTTP/1.0\r\nHost: localhost\r\n\r\n";
+
+    for (int i = 0; i < count; ++i) {
+        QTcpSocket socket;
+        socket.connectToHost(QHostAddress::LocalHost, port);
+        if (!socket.waitForConnected(2000)) {
+            failures->ref();
+            continue;
+        }
+
+        socket.write(request);
+        socket.waitForBytesWritten(2000);
+
+        while (socket.state() == QAbstractSocket::ConnectedState && socket.waitForReadyRead(2000)) {
+            socket.readAll();
+        }
+    }
+}
+
+void acceptSuite()
+{
+    const auto ping = [](QSharedPointer<QWebRequest>, QSharedPointer<QWebResponse> resp) {
+        resp->writeText("pong");
+    };
+
+    const int clients = 8;
+    const int connectionsPerClient = 500;
+
+    for (const bool reusePort : {false, true}) {
+        for (const int workers : {1, 2, 4, 8}) {
+            QScopedPointer<QWebService> service(QWebServiceConfig()
+                                                .get("/ping", ping)
+                                                .workerCount(workers)
+                                                .reusePort(reusePort)
+                                                .build());
+
+            const QString name = QString("accept + request (%1, %2 workers)")
+                    .arg(reusePort ? "SO_REUSEPORT" : "acceptor").arg(workers);
+
+            if (!service->startService(QHostAddress::LocalHost, 0)) {
+                QTextStream(stdout) << name << ": could not start service\n";
+                continue;
+            }
+
+            const quint16 port = service->serverPort();
+
+            QAtomicInt failures(0);
+            QAtomicInt running(clients);
+
+            QElapsedTimer timer;
+            timer.start();
+
+            std::vector<std::thread> threads;
+            for (int c = 0; c < clients; ++c) {
+                threads.emplace_back([&]() {
+                    runClient(port, connectionsPerClient, &failures);
+                    running.deref();
+                });
+            }
+
+            // the acceptor lives on this thread, keep its event loop going
+            QEventLoop loop;
+            QTimer poll;
+            QObject::connect(&poll, &QTimer::timeout, [&]() {
+                if (running.load() == 0) {
+                    loop.quit();
+                }
+            });
+            poll.start(5);
+            loop.exec();
+
+            for (std::thread &thread : threads) {
+                thread.join();
+            }
+
+            const int total = clients * connectionsPerClient;
+            report(name, double(timer.nsecsElapsed()) / total);
+
+            if (failures.load() > 0) {
+                QTextStream(stdout) << "    " << failures.load() << " connections failed\n";
+            }
+
+            service->stopService();
+        }
+    }
+}
+
+} // end namespace benchUtils
@@ -0,0 +1,108 @@
+
+#include "BenchUtils.h"
+
+#include "router/QWebJsonWriter.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+namespace benchUtils {
+
+/**
+ * A list of `count` user records, the shape most of our API returns.
+ */
+static
+QJsonDocument usersDocument(const int count)
+{
+    QJsonArray users;
+    for (int i = 0; i < count; ++i) {
+        QJsonObject user;
+        user["id"] = i;
+        user["name"] = QString("user %1").arg(i);
+        user["email"] = QString("user%1@example.com").arg(i);
+        user["active"] = i % 3 != 0;
+        user["score"] = i * 1.25;
+
+        QJsonArray roles;
+        roles.append(QString("reader"));
+        if (i % 10 == 0) {
+            roles.append(QString("admin"));
+        }
+        user["roles"] = roles;
+
+        users.append(user);
+    }
+
+    QJsonObject root;
+    root["count"] = count;
+    root["users"] = users;
+
+    return QJsonDocument(root);
+}
+
+/**
+ * Same as usersDocument(), through %QWebJsonWriter.
+ */
+static
+QByteArray usersWriter(const int count)
+{
+    QWebJsonWriter json(count * 128);
+
+    json.beginObject()
+            .field("count", count)
+            .key("users").beginArray();
+
+    for (int i = 0; i < count; ++i) {
+        json.beginObject()
+                .field("id", i)
+                .field("name", QString("user %1").arg(i))
+                .field("email", QString("user%1@example.com").arg(i))
+                .field("active", i % 3 != 0)
+                .field("score", i * 1.25)
+                .key("roles").beginArray().value("reader");
+
+        if (i % 10 == 0) {
+            json.value("admin");
+        }
+
+        json.endArray().endObject();
+    }
+
+    json.endArray().endObject();
+
+    return json.data();
+}
+
+void jsonSuite()
+{
+    for (const int count : {1, 100, 1000}) {
+        const int iterations = 20000 / count + 10;
+        const QString suffix = QString(" (%1 users)").arg(count);
+
+        const QJsonDocument doc = usersDocument(count);
+        const int indentedBytes = doc.toJson(QJsonDocument::Indented).size();
+        const int compactBytes = doc.toJson(QJsonDocument::Compact).size();
+        const int writerBytes = usersWriter(count).size();
+
+        // serialization of an already built document, what writeJson does
+        report(QString("toJson Indented, %1 bytes").arg(indentedBytes) + suffix, nsPerOp([&]() {
+            doc.toJson(QJsonDocument::Indented);
+        }, iterations));
+
+        report(QString("toJson Compact, %1 bytes").arg(compactBytes) + suffix, nsPerOp([&]() {
+            doc.toJson(QJsonDocument::Compact);
+        }, iterations));
+
+        // building the payload as well, as a handler does
+        report(QString("build + toJson Compact, %1 bytes").arg(compactBytes) + suffix, nsPerOp([&]() {
+            usersDocument(count).toJson(QJsonDocument::Compact);
+        }, iterations));
+
+        report(QString("QWebJsonWriter, %1 bytes").arg(writerBytes) + suffix, nsPerOp([&]() {
+            usersWriter(count);
+        }, iterations));
+    }
+}
+
+} // end namespace benchUtils
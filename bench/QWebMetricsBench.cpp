@@ -0,0 +1,36 @@
+
+#include "BenchUtils.h"
+
+#include "router/QWebMetrics.h"
+
+namespace benchUtils {
+
+void metricsSuite()
+{
+    const int routeCount = 100;
+
+    QWebMetrics metrics;
+    for (int i = 0; i < routeCount; ++i) {
+        metrics.addRoute("GET", QString("/svc%1/res%2/:id").arg(i % 8).arg(i));
+    }
+
+    QWebMetrics::Shard *shard = metrics.addShard();
+
+    // what the router adds to every response
+    int route = 0;
+    qint64 latency = 1000;
+
+    const auto record = [&]() {
+        shard->record(route, 200, 512, latency);
+        route = (route + 1) % routeCount;
+        latency = (latency * 7) % 50000000 + 1000;
+    };
+
+    report("QWebMetrics::Shard::record", nsPerOp(record, 1000000), allocsPerOp(record, 1000000));
+
+    report(QString("QWebMetrics::toPrometheus (%1 routes)").arg(routeCount), nsPerOp([&]() {
+        metrics.toPrometheus();
+    }, 200));
+}
+
+} // end namespace benchUtils
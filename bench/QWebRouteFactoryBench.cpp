@@ -0,0 +1,101 @@
+
+#include "BenchUtils.h"
+
+#include "router/QWebRoute.h"
+
+#include <QList>
+#include <QPair>
+#include <QRegularExpression>
+
+namespace benchUtils {
+
+/**
+ * A route of each kind the path DSL supports, with a path it matches and one
+ * it does not.
+ */
+struct RouteCase {
+    const char *name;
+    const char *route;
+    const char *hit;
+    const char *miss;
+};
+
+static const RouteCase ROUTE_CASES[] = {
+    { "static", "/api/v1/health", "/api/v1/health", "/api/v1/status" },
+    { "named", "/users/:id", "/users/1234", "/users" },
+    { "param heavy", "/org/:org/team/:team/user/:user/repo/:repo/file/:file",
+      "/org/acme/team/core/user/kevin/repo/qtws/file/main-cpp",
+      "/org/acme/team/core/user/kevin/repo/qtws/blob/main-cpp" },
+    { "wildcard", "/files/*/thumb+", "/files/2014/thumb-large", "/files/2014/full" }
+};
+
+void routeFactorySuite()
+{
+    const QWebRouteFactory factory;
+    const int iterations = 20000;
+
+    for (const RouteCase &routeCase : ROUTE_CASES) {
+        const QString spec = routeCase.route;
+
+        const auto create = [&]() {
+            factory.create(spec);
+        };
+
+        report(QString("QWebRouteFactory::create (%1)").arg(routeCase.name),
+               nsPerOp(create, iterations), allocsPerOp(create, iterations));
+    }
+
+    const QString pattern = "^/users/(?<id>\\d+)/posts/(?<post>\\d+)$";
+
+    const auto createRegex = [&]() {
+        factory.createRegex(pattern);
+    };
+
+    report("QWebRouteFactory::createRegex (named groups)",
+           nsPerOp(createRegex, iterations), allocsPerOp(createRegex, iterations));
+}
+
+void checkPathSuite()
+{
+    const QWebRouteFactory factory;
+    const int iterations = 200000;
+
+    QList<QPair<QString, QWebRoute::Ptr> > routes;
+    for (const RouteCase &routeCase : ROUTE_CASES) {
+        routes += qMakePair(QString(routeCase.name), factory.create(routeCase.route));
+    }
+
+    const QWebRoute::Ptr regex = factory.createRegex("^/users/(?<id>\\d+)/posts/(?<post>\\d+)$");
+
+    for (int i = 0; i < routes.size(); ++i) {
+        const QWebRoute::Ptr route = routes[i].second;
+        const QString hit = ROUTE_CASES[i].hit;
+        const QString miss = ROUTE_CASES[i].miss;
+
+        QWebRoute::Match match;
+
+        const auto checkHit = [&]() {
+            route->checkPath(hit, &match);
+        };
+        const auto checkMiss = [&]() {
+            route->checkPath(miss, &match);
+        };
+
+        report(QString("QWebRoute::checkPath (%1, hit)").arg(routes[i].first),
+               nsPerOp(checkHit, iterations), allocsPerOp(checkHit, iterations));
+        report(QString("QWebRoute::checkPath (%1, miss)").arg(routes[i].first),
+               nsPerOp(checkMiss, iterations), allocsPerOp(checkMiss, iterations));
+    }
+
+    QWebRoute::Match match;
+    const QString regexHit = "/users/1234/posts/42";
+
+    const auto checkRegex = [&]() {
+        regex->checkPath(regexHit, &match);
+    };
+
+    report("QWebRoute::checkPath (regex, hit)",
+           nsPerOp(checkRegex, iterations), allocsPerOp(checkRegex, iterations));
+}
+
+} // end namespace benchUtils
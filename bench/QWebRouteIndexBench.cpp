@@ -0,0 +1,74 @@
+
+#include "BenchUtils.h"
+
+#include "router/QWebRoute.h"
+#include "router/QWebRouteIndex.h"
+
+#include <QList>
+#include <QStringList>
+
+namespace benchUtils {
+
+/**
+ * Every other route has a named level, the rest a named level and a wildcard,
+ * so none of them are static.
+ */
+static
+QList<QWebRoute::Ptr> syntheticRoutes(const QWebRouteFactory &factory, const int count)
+{
+    QList<QWebRoute::Ptr> routes;
+    for (int i = 0; i < count; ++i) {
+        const QString base = QString("/svc%1/res%2/:id").arg(i % 8).arg(i);
+
+        routes += factory.create(i % 2 ? base + "/item+" : base);
+    }
+
+    return routes;
+}
+
+void routeIndexSuite()
+{
+    const QWebRouteFactory factory;
+
+    for (const int count : {10, 100, 1000}) {
+        const QList<QWebRoute::Ptr> routes = syntheticRoutes(factory, count);
+
+        const QWebRouteIndex tree(routes, QWebRouteIndex::LEVEL_TREE);
+        const QWebRouteIndex combined(routes, QWebRouteIndex::COMBINED_REGEX);
+
+        const QStringList paths = {
+            "/svc0/res0/42",
+            QString("/svc%1/res%2/42").arg((count - 2) % 8).arg(count - 2),
+            "/svc0/nothing/here"
+        };
+        const QStringList pathNames = { "first", "last", "miss" };
+
+        const int iterations = 100000 / count + 100;
+
+        for (int p = 0; p < paths.size(); ++p) {
+            const QString &path = paths[p];
+            const QString suffix = QString(" (%1 routes, %2)").arg(count).arg(pathNames[p]);
+
+            // what QWebRouter::handleRoute did before QWebRouteIndex
+            report("linear checkPath" + suffix, nsPerOp([&]() {
+                for (const QWebRoute::Ptr &route : routes) {
+                    if (route->checkPath(path)) {
+                        break;
+                    }
+                }
+            }, iterations));
+
+            QWebRoute::Match match;
+
+            report("LEVEL_TREE" + suffix, nsPerOp([&]() {
+                tree.match(path, &match);
+            }, iterations));
+
+            report("COMBINED_REGEX" + suffix, nsPerOp([&]() {
+                combined.match(path, &match);
+            }, iterations));
+        }
+    }
+}
+
+} // end namespace benchUtils
@@ -0,0 +1,155 @@
+
+#include "BenchUtils.h"
+
+#include "QWebService.h"
+#include "QWebServiceConfig.h"
+#include "router/QWebJsonWriter.h"
+#include "router/QWebMiddleWare.h"
+#include "router/QWebRequest.h"
+#include "router/QWebResponse.h"
+#include "router/QWebRouter.h"
+
+#include <QList>
+#include <QPair>
+#include <QScopedPointer>
+#include <QStringList>
+
+namespace benchUtils {
+
+//!< Route tables measured, in number of routes
+static const int TABLE_SIZES[] = { 10, 100, 1000, 10000 };
+
+/**
+ * Builds a service with `count` dynamic routes next to a static and a param
+ * heavy one, all handled by `func`.
+ */
+static
+QWebService *syntheticService(const int count, const QWebService::RouteFunction &func)
+{
+    QWebServiceConfig config;
+    for (int i = 0; i < count; ++i) {
+        config.get(QString("/svc%1/res%2/:id").arg(i % 8).arg(i), func);
+    }
+
+    config.get("/health", func)
+          .get("/org/:org/team/:team/user/:user/repo/:repo/file/:file", func);
+
+    return config.build();
+}
+
+/**
+ * Named paths for a table of `count` routes: a static hit, the first and last
+ * dynamic route, a param heavy hit and a miss.
+ */
+static
+QList<QPair<QString, QString> > syntheticPaths(const int count)
+{
+    return QList<QPair<QString, QString> >()
+            << qMakePair(QString("static hit"), QString("/health"))
+            << qMakePair(QString("first"), QString("/svc0/res0/1234"))
+            << qMakePair(QString("last"), QString("/svc%1/res%2/1234").arg((count - 1) % 8).arg(count - 1))
+            << qMakePair(QString("param heavy"), QString("/org/acme/team/core/user/kevin/repo/qtws/file/main-cpp"))
+            << qMakePair(QString("miss"), QString("/nothing/here"));
+}
+
+/**
+ * Ten paths cycled through, nine hits spread over the table and a miss.
+ */
+static
+QStringList mixedPaths(const int count)
+{
+    QStringList paths;
+    for (int i = 0; i < 9; ++i) {
+        const int route = (count - 1) * i / 8;
+        paths += QString("/svc%1/res%2/%3").arg(route % 8).arg(route).arg(i);
+    }
+
+    paths += "/svc0/nothing/here";
+
+    return paths;
+}
+
+void routerSuite()
+{
+    const auto noop = [](QSharedPointer<QWebRequest>, QSharedPointer<QWebResponse>) { };
+
+    for (const int count : TABLE_SIZES) {
+        QScopedPointer<QWebService> service(syntheticService(count, noop));
+        const QWebRouter *router = service->router();
+
+        const int iterations = 100000;
+
+        for (const QPair<QString, QString> &path : syntheticPaths(count)) {
+            QWebRoute::Match match;
+
+            const auto dispatch = [&]() {
+                router->findRoute(QWebService::HttpMethod::HTTP_GET, path.second, &match);
+            };
+
+            report(QString("QWebRouter::findRoute (%1 routes, %2)").arg(count).arg(path.first),
+                   nsPerOp(dispatch, iterations), allocsPerOp(dispatch, iterations));
+        }
+
+        const QStringList mixed = mixedPaths(count);
+        int next = 0;
+        QWebRoute::Match match;
+
+        const auto dispatchMixed = [&]() {
+            router->findRoute(QWebService::HttpMethod::HTTP_GET, mixed[next], &match);
+            next = (next + 1) % mixed.size();
+        };
+
+        report(QString("QWebRouter::findRoute (%1 routes, 90% hit mix)").arg(count),
+               nsPerOp(dispatchMixed, iterations), allocsPerOp(dispatchMixed, iterations));
+    }
+}
+
+void dispatchSuite()
+{
+    // reads its captures and answers with a small JSON object, like most of
+    // our handlers
+    const auto handler = [](QSharedPointer<QWebRequest> req, QSharedPointer<QWebResponse> resp) {
+        const QHash<QString, QString> &params = req->urlParams();
+
+        QWebJsonWriter json;
+        json.beginObject();
+        for (auto it = params.constBegin(); it != params.constEnd(); ++it) {
+            json.field(it.key(), it.value());
+        }
+        json.endObject();
+
+        resp->writeJson(json);
+    };
+
+    for (const int count : TABLE_SIZES) {
+        QScopedPointer<QWebService> service(syntheticService(count, handler));
+        const QWebRouter *router = service->router();
+
+        const int iterations = 50000;
+
+        for (const QPair<QString, QString> &path : syntheticPaths(count)) {
+            // the steps of QWebRouter::handleRoute, the QHttpRequest and
+            // QHttpResponse are left out as only a connection can create them
+            const auto dispatch = [&]() {
+                QWebRoute::Match match;
+                const QWebRouter::RouteEntry *entry =
+                        router->findRoute(QWebService::HttpMethod::HTTP_GET, path.second, &match);
+
+                QSharedPointer<QWebRequest> req = QWebRequest::create(nullptr, match);
+                QSharedPointer<QWebResponse> resp = QWebResponse::create();
+
+                if (!entry) {
+                    resp->setStatusCode(QWebResponse::StatusCode::STATUS_NOT_FOUND);
+                    resp->writeText("404 Not Found");
+                } else if (QWebMiddleWare::run(entry->middleware, req, resp)) {
+                    entry->func(req, resp);
+                }
+            };
+
+            report(QString("dispatch (%1 routes, %2)").arg(count).arg(path.first),
+                   nsPerOp(dispatch, iterations), allocsPerOp(dispatch, iterations));
+        }
+    }
+}
+
+} // end namespace benchUtils
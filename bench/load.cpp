@@ -0,0 +1,222 @@
+/*
+ * Copyright 2014 Kevin Brightwell <kevin.brightwell2@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+  * qwebservice-load, end to end throughput of a service on the loopback
+  * interface. Boots a service on a port picked by the system and runs each
+  * scenario against it, or with `--target host:port` sends GETs of `--path`
+  * to a running server instead.
+  *
+  *     qwebservice-load [--connections 16] [--pipeline 1] [--duration 3000]
+  *                      [--workers 0] [--scenario name]... [--json file]
+  *                      [--target host:port [--path /]]
+  */
+#include "LoadGenerator.h"
+
+#include "QWebService.h"
+#include "QWebServiceConfig.h"
+#include "router/QWebJsonWriter.h"
+#include "router/QWebRequest.h"
+#include "router/QWebResponse.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QScopedPointer>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+using namespace benchUtils;
+
+static
+QWebService *buildService(const QString &staticRoot, const int workers)
+{
+    const auto json = [](QSharedPointer<QWebRequest>, QSharedPointer<QWebResponse> resp) {
+        QWebJsonWriter writer;
+        writer.beginObject()
+                .field("id", 42)
+                .field("name", "small")
+                .field("active", true)
+            .endObject();
+
+        resp->writeJson(writer);
+    };
+
+    const auto upload = [](QSharedPointer<QWebRequest> req, QSharedPointer<QWebResponse> resp) {
+        resp->writeText(QString::number(req->bodySize()));
+    };
+
+    return QWebServiceConfig()
+            .get("/json", json)
+            .post("/upload", upload)
+            .serveDirectory("/static", staticRoot)
+            .workerCount(workers)
+            .build();
+}
+
+static
+void printResult(const QString &name, const LoadResult &result)
+{
+    QTextStream out(stdout);
+    out << name.leftJustified(24)
+        << QString::number(result.requestsPerSecond(), 'f', 0).rightJustified(10) << " req/s"
+        << "  p50 " << QString::number(result.percentileUsec(0.5), 'f', 0).rightJustified(7) << " us"
+        << "  p99 " << QString::number(result.percentileUsec(0.99), 'f', 0).rightJustified(7) << " us"
+        << "  p999 " << QString::number(result.percentileUsec(0.999), 'f', 0).rightJustified(7) << " us";
+
+    if (result.errors > 0) {
+        out << "  " << result.errors << " errors";
+    }
+
+    out << '\n';
+}
+
+static
+QJsonObject toJson(const QString &name, const LoadResult &result)
+{
+    QJsonObject obj;
+    obj["name"] = name;
+    obj["requestsPerSecond"] = result.requestsPerSecond();
+    obj["p50Usec"] = result.percentileUsec(0.5);
+    obj["p99Usec"] = result.percentileUsec(0.99);
+    obj["p999Usec"] = result.percentileUsec(0.999);
+    obj["responses"] = double(result.responses);
+    obj["errors"] = double(result.errors);
+
+    return obj;
+}
+
+/**
+ * Value following `name` in `args`, `fallback` if it is not there.
+ */
+static
+QString option(const QStringList &args, const QString &name, const QString &fallback = QString())
+{
+    const int at = args.indexOf(name);
+
+    return at >= 0 && at + 1 < args.size() ? args[at + 1] : fallback;
+}
+
+int main( int argc, char* argv[] )
+{
+  QCoreApplication app(argc,argv);
+
+  const QStringList args = app.arguments();
+
+  LoadOptions options;
+  options.connections = option(args, "--connections", "16").toInt();
+  options.pipeline = option(args, "--pipeline", "1").toInt();
+  options.durationMsec = option(args, "--duration", "3000").toInt();
+
+  const int workers = option(args, "--workers", "0").toInt();
+  const QString jsonFile = option(args, "--json");
+
+  QStringList only;
+  for (int i = 0; i + 1 < args.size(); ++i) {
+    if (args[i] == "--scenario") {
+      only += args[i + 1];
+    }
+  }
+
+  QJsonArray results;
+
+  const QString target = option(args, "--target");
+  if (!target.isEmpty()) {
+    const int colon = target.lastIndexOf(':');
+    const QHostAddress address(target.left(colon) == "localhost" ? "127.0.0.1" : target.left(colon));
+    const quint16 port = quint16(target.mid(colon + 1).toUInt());
+
+    options.mix << qMakePair(buildRequest("GET", option(args, "--path", "/").toLatin1()), 1);
+
+    const LoadResult result = runLoad(address, port, options);
+    printResult(target, result);
+    results.append(toJson(target, result));
+  } else {
+    QTemporaryDir root;
+    QFile css(root.path() + "/app.css");
+    if (!root.isValid() || !css.open(QIODevice::WriteOnly)) {
+      QTextStream(stderr) << "Could not create the static files\n";
+      return 1;
+    }
+    css.write(QByteArray("body { margin: 0; }\n").repeated(16 * 1024 / 20));
+    css.close();
+
+    const QByteArray json = buildRequest("GET", "/json");
+    const QByteArray file = buildRequest("GET", "/static/app.css");
+    const QByteArray missing = buildRequest("GET", "/missing/page");
+    const QByteArray upload = buildRequest("POST", "/upload", QByteArray(1024 * 1024, 'x'));
+
+    QList<QPair<QString, QList<QPair<QByteArray, int> > > > scenarios;
+    scenarios << qMakePair(QString("small json"), QList<QPair<QByteArray, int> >() << qMakePair(json, 1))
+              << qMakePair(QString("static file"), QList<QPair<QByteArray, int> >() << qMakePair(file, 1))
+              << qMakePair(QString("404 flood"), QList<QPair<QByteArray, int> >() << qMakePair(missing, 1))
+              << qMakePair(QString("large upload"), QList<QPair<QByteArray, int> >() << qMakePair(upload, 1))
+              << qMakePair(QString("mixed"), QList<QPair<QByteArray, int> >()
+                           << qMakePair(json, 16) << qMakePair(file, 3) << qMakePair(missing, 1));
+
+    QTextStream(stdout) << options.connections << " connections, pipeline " << options.pipeline
+                        << ", " << workers << " workers, " << options.durationMsec << " ms each\n";
+
+    for (const auto &scenario : scenarios) {
+      if (!only.isEmpty() && !only.contains(scenario.first)) {
+        continue;
+      }
+
+      QScopedPointer<QWebService> service(buildService(root.path(), workers));
+
+      if (!service->startService(QHostAddress::LocalHost, 0)) {
+        QTextStream(stdout) << scenario.first << ": could not start service\n";
+        continue;
+      }
+
+      const quint16 port = service->serverPort();
+
+      options.mix = scenario.second;
+
+      const LoadResult result = runLoad(QHostAddress::LocalHost, port, options);
+      printResult(scenario.first, result);
+      results.append(toJson(scenario.first, result));
+
+      service->stopService();
+    }
+  }
+
+  if (!jsonFile.isEmpty()) {
+    QFile out(jsonFile);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+      QTextStream(stderr) << "Could not write " << jsonFile << "\n";
+      return 1;
+    }
+
+    QJsonObject root;
+    root["connections"] = options.connections;
+    root["pipeline"] = options.pipeline;
+    root["workers"] = workers;
+    root["results"] = results;
+    out.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+  }
+
+  return 0;
+}
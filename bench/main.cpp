@@ -0,0 +1,62 @@
+/*
+ * Copyright 2014 Kevin Brightwell <kevin.brightwell2@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+  * Benchmarks for the routing internals, run with a release build. With
+  * `--json <file>` the results are also written to `file` to compare runs.
+  */
+#include "BenchUtils.h"
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTextStream>
+
+int main( int argc, char* argv[] )
+{
+  QCoreApplication app(argc,argv);
+
+  const QStringList args = app.arguments();
+  const int jsonArg = args.indexOf("--json");
+
+  if (jsonArg >= 0 && jsonArg + 1 >= args.size()) {
+    QTextStream(stderr) << "Usage: " << args.first() << " [--json <file>]\n";
+    return 1;
+  }
+
+  benchUtils::routeFactorySuite();
+  benchUtils::checkPathSuite();
+  benchUtils::routeIndexSuite();
+  benchUtils::routerSuite();
+  benchUtils::dispatchSuite();
+  benchUtils::metricsSuite();
+  benchUtils::jsonSuite();
+#if defined(Q_OS_LINUX)
+  benchUtils::acceptSuite();
+#endif
+
+  if (jsonArg >= 0 && !benchUtils::writeJsonResults(args[jsonArg + 1])) {
+    QTextStream(stderr) << "Could not write " << args[jsonArg + 1] << "\n";
+    return 1;
+  }
+
+  return 0;
+}
@@ -46,7 +46,9 @@ class QTWEBSERVICE_API QWebService : public QObject {
     /// @endcond
 
 public:
-    /// Defines the signature for a routing function
+    /// Defines the signature for a routing function, when the service uses
+    /// worker threads it is called on one of them, see
+    /// QWebServiceConfig::workerCount.
     typedef std::function<void(const QSharedPointer<QWebRequest>, const QSharedPointer<QWebResponse>)> RouteFunction;
 
     typedef QHttpRequest::HttpMethod HttpMethod;
@@ -55,7 +57,8 @@ public:
     ~QWebService();
 
     /**
-     * @brief startService Starts the service on the passed addresses
+     * @brief startService Starts the service on the passed addresses, with
+     * worker threads configured they are started here.
      * @param address
      * @param port
      * @return True if successful.
@@ -63,10 +66,27 @@ public:
     bool startService(const QHostAddress &address = QHostAddress::Any, quint16 port = 80);
 
     /**
-     * @brief stopService Tries to stop the service
+     * @brief stopService Tries to stop the service, worker threads are joined
+     * before this returns.
      */
     void stopService();
 
+    /**
+     * @brief serverPort Port the service listens on, resolves the port
+     * chosen by the system when started on port 0.
+     * @return 0 if the service is not running
+     */
+    quint16 serverPort() const;
+
+    /**
+     * @brief router Routing table of the service
+     * @return Router, owned by the service
+     */
+    inline
+    const QWebRouter *router() const {
+        return m_router;
+    }
+
 signals:
 
     /**
@@ -83,11 +103,20 @@ signals:
 private:
     QWebService(QHttpServer *server,
                 QWebRouter *router,
+                const int workerCount = 0,
+                const bool reusePort = false,
                 QObject *parent = nullptr);
 
+    //!< Serves on the owning thread, `nullptr` if worker threads are used
     QHttpServer * const m_server;
     QWebRouter * const m_router;
 
+    //!< Accepts and hands out connections to the worker threads, `nullptr` if
+    //!< there are none
+    QWebWorkerPool * const m_workers;
+
+    bool m_running;
+
 };
 
 
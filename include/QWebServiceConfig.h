@@ -25,6 +25,7 @@
 #define QWEBSERVICECONFIG_H
 
 #include <QRegularExpression>
+#include <QStringList>
 #include <QString>
 #include <QSharedPointer>
 #include <QHttpServer/qhttpserver.h>
@@ -35,6 +36,11 @@
 #include "private/qtwebservicefwd.h"
 
 #include "QWebService.h"
+#include "router/QWebRouteIndex.h"
+#include "router/QWebRouter.h"
+#include "router/QWebAccessLog.h"
+#include "router/QWebTracer.h"
+#include "router/QWebMiddleWare.h"
 
 /// @cond noDoc
 /// Simple wayt to define the type, while not typedefing it because we don't want to leak it
@@ -70,6 +76,24 @@ public:
         //!< Routing fuction pointer
         const QWebService::RouteFunction func;
 
+        //!< Largest request body accepted in bytes, -1 for the service default
+        qint64 maxBodySize;
+
+        //!< Deliver the body through QWebRequest::bodyData instead of buffering it
+        bool streamBody;
+
+        //!< Middleware of only this route, runs after the global middleware
+        QWebMiddleWare::Chain middleware;
+
+        //!< Milliseconds responses of the route are cached, 0 to not cache
+        int cacheTtl;
+
+        //!< Query parameters that are part of the cache key
+        QStringList cacheKeys;
+
+        //!< Answer conditional requests, see QWebServiceConfig::conditional()
+        bool conditional;
+
     public:
         /**
          * @brief create New shared pointer (saves lifetime concerns)
@@ -95,14 +119,16 @@ public:
         explicit
         Key(const QString &path, QWebService::RouteFunction func)
             : path(path), reg(), strRep(path),
-              isPath(true), func(func) {
+              isPath(true), func(func), maxBodySize(-1), streamBody(false),
+              cacheTtl(0), cacheKeys(), conditional(false) {
 
         }
 
         explicit
         Key(const QRegularExpression &reg, QWebService::RouteFunction func)
             : path(), reg(reg), strRep(reg.pattern()),
-              isPath(false), func(func) {
+              isPath(false), func(func), maxBodySize(-1), streamBody(false),
+              cacheTtl(0), cacheKeys(), conditional(false) {
 
         }
     };
@@ -263,6 +289,254 @@ public:
     }
 
 
+    /**
+     * @brief routeIndexStrategy Sets how routes written in the path DSL are
+     *      matched, defaults to %QWebRouteIndex::LEVEL_TREE.
+     * @param strategy Strategy to use for every method
+     * @return reference to `*this`.
+     */
+    QWebServiceConfig &routeIndexStrategy(const QWebRouteIndex::Strategy strategy);
+
+    /**
+     * @brief workerCount Sets the number of worker threads, each with its own
+     *      event loop and router, that connections are spread across. With
+     *      the default of 0 everything runs on the thread of the service.
+     *
+     * Handlers are then called on the worker threads, concurrently, and must
+     * be thread-safe. Handler objects are not moved to the workers, so they
+     * should not rely on their own thread's event loop.
+     * @param count Number of threads, for example QThread::idealThreadCount()
+     * @return reference to `*this`.
+     */
+    QWebServiceConfig &workerCount(const int count);
+
+    /**
+     * @brief reusePort If enabled, every worker thread listens on its own
+     *      socket bound with `SO_REUSEPORT` and the kernel balances accepts
+     *      between them, instead of one thread accepting for all. Only
+     *      supported on Linux, QWebService::startService fails elsewhere.
+     *      Has no effect without worker threads, see workerCount().
+     * @param enabled Defaults to false
+     * @return reference to `*this`.
+     */
+    QWebServiceConfig &reusePort(const bool enabled);
+
+    /**
+     * @brief maxBodySize Limits the request body of the route added last, for
+     *      every method it was added for. Larger requests are answered with a
+     *      413 before their body is buffered:
+     *
+     *          config.post("/upload", handler).maxBodySize(10 * 1024 * 1024);
+     *
+     * @param bytes Largest body accepted, -1 uses defaultMaxBodySize()
+     * @return reference to `*this`.
+     */
+    QWebServiceConfig &maxBodySize(const qint64 bytes);
+
+    /**
+     * @brief use Adds middleware run before the handler of every route, in
+     *      the order it was added, no matter if the routes were added before
+     *      or after. Not run for requests no route matched.
+     * @param func Returns false to skip the handler, see %QWebMiddleWare
+     * @return reference to `*this`.
+     */
+    QWebServiceConfig &use(const QWebMiddleWare::Function &func);
+
+    /**
+     * @brief middleware Adds middleware run before the handler of the route
+     *      added last, after the global middleware:
+     *
+     *          config.get("/admin", handler).middleware(requireAuth);
+     *
+     * @param func Returns false to skip the handler, see %QWebMiddleWare
+     * @return reference to `*this`.
+     */
+    QWebServiceConfig &middleware(const QWebMiddleWare::Function &func);
+
+    /**
+     * @brief streamBody Makes the route added last deliver its request body
+     *      as it arrives instead of buffering it. The handler is called as
+     *      soon as the headers are in and reads the body through
+     *      QWebRequest::bodyData() and QWebRequest::bodyEnd(), it usually
+     *      defers its response until then:
+     *
+     *          config.put("/files/:name", [](QSharedPointer<QWebRequest> req,
+     *                                        QSharedPointer<QWebResponse> resp) {
+     *              resp->defer();
+     *              QObject::connect(req.data(), &QWebRequest::bodyData, ...);
+     *              QObject::connect(req.data(), &QWebRequest::bodyEnd, ...);
+     *          }).streamBody();
+     *
+     * @param enabled Defaults to true
+     * @return reference to `*this`.
+     */
+    QWebServiceConfig &streamBody(const bool enabled = true);
+
+    /**
+     * @brief cache Caches the responses of the route added last for `ttl`
+     *      milliseconds. Only successful `GET` requests are cached, keyed by
+     *      their path and the values of `queryKeys`, other query parameters
+     *      are ignored:
+     *
+     *          config.get("/reports/:id", handler).cache(60 * 1000, {"page"});
+     *
+     * While cached the handler is not called. Middleware still runs first if
+     * the route has any, so it can reject a request, and the headers it sets
+     * are sent along. Only the headers describing the body are cached, and
+     * responses setting a cookie or marked `Cache-Control: private` or
+     * `no-store` are not. Streamed responses, see QWebResponse::writeFile(),
+     * are never cached. Needs responseCacheSize().
+     * @param ttl Milliseconds a response is served from the cache, 0 disables it
+     * @param queryKeys Query parameters the response depends on
+     * @return reference to `*this`.
+     */
+    QWebServiceConfig &cache(const int ttl, const QStringList &queryKeys = QStringList());
+
+    /**
+     * @brief serveDirectory Serves the files below `root` for `GET` requests
+     *      of paths under `prefix`, `/static/css/site.css` reads
+     *      `root/css/site.css` for the prefix `/static`:
+     *
+     *          config.serveDirectory("/static", "/var/www/static");
+     *
+     * Paths with `..` levels and symbolic links leading out of `root` are
+     * answered with a 404. The `Content-Type` comes from the file extension.
+     * Files of up to QWebStaticFiles::MAX_CACHED_FILE_SIZE are kept in memory
+     * until they change on disk, along with their `.gz` sibling, see
+     * precompressed(), or their compressed bodies, see compression(), so
+     * hits are never compressed again. Responses carry validators, see
+     * conditional(), and single byte ranges are answered with a 206.
+     * @param prefix Path the directory is served under
+     * @param root Directory to serve
+     * @param cacheSize Bytes of file contents kept in memory
+     * @return reference to `*this`.
+     */
+    QWebServiceConfig &serveDirectory(const QString &prefix, const QString &root,
+                                      const qint64 cacheSize = 64 * 1024 * 1024);
+
+    /**
+     * @brief conditional Makes the route added last tag its successful
+     *      responses with a strong `ETag`, a hash of the body or the size and
+     *      modification time for QWebResponse::writeFile(), which also sets
+     *      `Last-Modified`. `GET` and `HEAD` requests whose `If-None-Match`
+     *      or `If-Modified-Since` match are answered with a 304 and no body,
+     *      files are then not opened. Handlers may set their own tags with
+     *      QWebResponse::setETag().
+     * @param enabled Defaults to true
+     * @return reference to `*this`.
+     */
+    QWebServiceConfig &conditional(const bool enabled = true);
+
+    /**
+     * @brief responseCacheSize Sets the memory kept for responses of routes
+     *      with cache(), least recently used responses are dropped first.
+     *      Every worker thread has a cache of this size.
+     * @param bytes Defaults to 0, which disables caching
+     * @return reference to `*this`.
+     */
+    QWebServiceConfig &responseCacheSize(const qint64 bytes);
+
+    /**
+     * @brief compression Compresses responses with gzip or deflate, as the
+     *      client's `Accept-Encoding` allows. Only bodies of at least
+     *      `minSize` bytes with a type from compressTypes() are compressed,
+     *      streamed responses never are, see precompressed() for files.
+     * @param level zlib level from 1 (fastest) to 9 (smallest), 0 disables it
+     * @param minSize Smallest body compressed, in bytes
+     * @return reference to `*this`.
+     */
+    QWebServiceConfig &compression(const int level = 6, const qint64 minSize = 1024);
+
+    /**
+     * @brief compressTypes Sets the content types compression() applies to,
+     *      entries ending in `/` match every subtype. Defaults to
+     *      QWebCompression::defaultTypes().
+     * @return reference to `*this`.
+     */
+    QWebServiceConfig &compressTypes(const QStringList &types);
+
+    /**
+     * @brief precompressed Makes QWebResponse::writeFile() send
+     *      `<file>.gz` instead of the file if it exists and the client
+     *      accepts gzip, so static files are compressed ahead of time.
+     * @param enabled Defaults to true
+     * @return reference to `*this`.
+     */
+    QWebServiceConfig &precompressed(const bool enabled = true);
+
+    /**
+     * @brief metrics Counts responses, status codes, bytes sent and
+     *      latency per registered route and serves them for `GET path` in
+     *      the Prometheus text format. Every worker counts into its own
+     *      shard, requests only pay for a few plain stores.
+     *
+     *      Example:
+     *
+     *          config.metrics();   // GET /metrics
+     *
+     * @param path Route of the metrics, registered after every other route
+     * @return reference to `*this`.
+     */
+    QWebServiceConfig &metrics(const QString &path = "/metrics");
+
+    /**
+     * @brief accessLog Appends a line per response to `fileName`. Workers
+     *      only queue a record, a background thread formats and writes them
+     *      in batches. Records are dropped rather than slowing requests down
+     *      if it falls behind.
+     *
+     *      Example:
+     *
+     *          config.accessLog("/var/log/service/access.log", QWebAccessLog::JSON_FORMAT, 10);
+     *
+     * @param fileName File appended to, an empty name turns the log off
+     * @param format Pattern of a line, see QWebAccessLog::Settings::format
+     * @param sampleEvery Logs one of every `sampleEvery` responses, server
+     *      errors are always logged
+     * @return reference to `*this`.
+     */
+    QWebServiceConfig &accessLog(const QString &fileName,
+                                 const QString &format = QWebAccessLog::DEFAULT_FORMAT,
+                                 const int sampleEvery = 1);
+
+    /**
+     * @brief trace Writes when each phase of a sampled request ran, routing,
+     *      receiving the body, the handler, waiting for a deferred
+     *      response, serializing and writing, as Chrome trace events to
+     *      `fileName`. Open it in `chrome://tracing` or Perfetto for a
+     *      waterfall of each request. Requests not sampled only pay for a
+     *      counter, responses from the cache are not traced.
+     * @param fileName File written over, an empty name turns tracing off
+     * @param sampleEvery Traces one of every `sampleEvery` requests
+     * @return reference to `*this`.
+     */
+    QWebServiceConfig &trace(const QString &fileName, const int sampleEvery = 100);
+
+    /**
+     * @brief defaultMaxBodySize Limits the request body of routes without
+     *      their own limit, see maxBodySize().
+     * @param bytes Largest body accepted, -1 (the default) for no limit
+     * @return reference to `*this`.
+     */
+    QWebServiceConfig &defaultMaxBodySize(const qint64 bytes);
+
+    /**
+     * @brief asyncTimeout Sets how long a deferred response, see
+     *      QWebResponse::defer(), may take before the client is sent a 504.
+     * @param msec Milliseconds, 0 waits forever. Defaults to 30 seconds.
+     * @return reference to `*this`.
+     */
+    QWebServiceConfig &asyncTimeout(const int msec);
+
+    /**
+     * @brief jsonFormat Sets how %QJsonDocument responses are serialized,
+     *      handlers may override it per response with
+     *      QWebResponse::setJsonFormat().
+     * @param format Defaults to %QJsonDocument::Compact
+     * @return reference to `*this`.
+     */
+    QWebServiceConfig &jsonFormat(const QJsonDocument::JsonFormat format);
+
     /**
      * Create a new instance of %QHttpServer, configuring it.
      * @param parent Parent of new Builder
@@ -296,14 +570,40 @@ private:
     inline
     void addHandler(const QWebService::HttpMethod method, const Key::Ptr key) {
         m_handlers[method] += key;
+        m_lastKey = key;
     }
 
-    QHash<QWebService::HttpMethod, QSet<Key::Ptr> > m_handlers;
+    //!< Handlers per method, kept in registration order
+    QHash<QWebService::HttpMethod, QList<Key::Ptr> > m_handlers;
+
+    //!< Key added last, per route options apply to it
+    Key::Ptr m_lastKey;
+
+    //!< Middleware of every route, see use()
+    QWebMiddleWare::Chain m_middleware;
 
     QSet<QObject *> m_specialHandlers;
 
     QWebService::RouteFunction m_404;
 
+    QWebRouteIndex::Strategy m_indexStrategy;
+
+    int m_workerCount;
+
+    bool m_reusePort;
+
+    //!< Options passed on to the router
+    QWebRouter::Settings m_settings;
+
+    //!< Route serving the metrics, empty if they are off
+    QString m_metricsPath;
+
+    //!< Options of the access log, off if it has no file name
+    QWebAccessLog::Settings m_accessLog;
+
+    //!< Options of the tracer, off if it has no file name
+    QWebTracer::Settings m_trace;
+
     // needs to be a pointer because of forward declaration
     const QWebRouteFactory * const m_factory;
 
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2014 Kevin Brightwell <kevin.brightwell2@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef QWEBWORKER_H
+#define QWEBWORKER_H
+
+#include "qtwebservicefwd.h"
+
+#include <QObject>
+#include <QList>
+#include <QHostAddress>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+
+/**
+ * @brief The QWebWorker class serves the connections handed to it on the
+ * thread it lives on, using its own %QWebRouter.
+ */
+class QWebWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /**
+     * @brief QWebWorker
+     * @param router Router used for every request, the worker takes ownership
+     * @param parent QObject parent
+     */
+    explicit QWebWorker(QWebRouter *router, QObject *parent = nullptr);
+
+    virtual
+    ~QWebWorker();
+
+public slots:
+
+    /**
+     * @brief handleConnection Wraps an accepted socket in a %QHttpConnection
+     * owned by this worker.
+     * @param socketDescriptor Native descriptor of an accepted socket
+     */
+    void handleConnection(qintptr socketDescriptor);
+
+    /**
+     * @brief listen Opens a listening socket of this worker with
+     * `SO_REUSEPORT`, the kernel then balances accepts between every worker
+     * bound to the same address and port. Must be called on the worker's
+     * thread.
+     * @return False if the socket could not be opened, or `SO_REUSEPORT` is
+     *      not supported on this platform
+     */
+    bool listen(const QHostAddress &address, const quint16 port);
+
+public:
+
+    /**
+     * @brief port Port the listening socket is bound to, only meaningful
+     * after listen() succeeded; resolves a requested port of 0.
+     */
+    inline
+    quint16 port() const {
+        return m_listener ? m_listener->serverPort() : 0;
+    }
+
+private slots:
+
+    //!< Serves every connection pending on `m_listener`
+    void acceptPending();
+
+private:
+
+    //!< Hands `socket` to a new %QHttpConnection routed by `m_router`
+    void serve(QTcpSocket *socket);
+
+    QWebRouter * const m_router;
+
+    //!< This worker's own listening socket, `nullptr` unless listen() was used
+    QTcpServer *m_listener;
+
+};
+
+/**
+ * @brief The QWebWorkerPool class runs a set of %QWebWorker threads. By
+ * default it accepts connections on the thread that owns it and hands them
+ * out round-robin. With `reusePort` every worker listens on its own socket
+ * instead, so there is no single acceptor.
+ */
+class QWebWorkerPool : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+
+    /**
+     * @brief QWebWorkerPool
+     * @param router Router each worker's router is copied from
+     * @param count Number of worker threads, at least one is used
+     * @param reusePort If true, each worker opens its own `SO_REUSEPORT`
+     *      listening socket
+     * @param parent QObject parent
+     */
+    QWebWorkerPool(const QWebRouter *router, const int count,
+                   const bool reusePort = false, QObject *parent = nullptr);
+
+    virtual
+    ~QWebWorkerPool();
+
+    /**
+     * @brief start Starts the worker threads and listens on `address`
+     * @return True if listening, no threads are left running otherwise
+     */
+    bool start(const QHostAddress &address, const quint16 port);
+
+    /**
+     * @brief stop Stops listening, closes every open connection and joins
+     * the worker threads.
+     */
+    void stop();
+
+    /**
+     * @brief port Port the pool is bound to, resolves a requested port of 0.
+     * @return 0 if not started
+     */
+    quint16 port() const;
+
+protected:
+
+    virtual
+    void incomingConnection(qintptr socketDescriptor);
+
+private:
+
+    const QWebRouter * const m_router;
+
+    const int m_count;
+
+    const bool m_reusePort;
+
+    QList<QThread *> m_threads;
+
+    QList<QWebWorker *> m_workers;
+
+    //!< Index of the worker that gets the next connection
+    int m_next;
+
+};
+
+#endif // QWEBWORKER_H
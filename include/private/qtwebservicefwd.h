@@ -14,6 +14,18 @@ class QWebRoute;
 class QWebRouteFactory;
 class QWebRequest;
 class QWebResponse;
+class QWebResponseCache;
+class QWebCompression;
+class QWebStaticFiles;
+class QWebMetrics;
+class QWebAccessLog;
+class QWebTracer;
+class QWebTrace;
+class QWebJsonWriter;
+class QWebMultipartParser;
+
+class QWebWorker;
+class QWebWorkerPool;
 
 // Define to export or import depending if we are building or using the library.
 // QTWEBAPPLICATION_EXPORT should only be defined when building.
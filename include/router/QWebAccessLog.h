@@ -0,0 +1,222 @@
+/*
+ * Copyright 2014 Kevin Brightwell <kevin.brightwell2@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef QWEBACCESSLOG_H
+#define QWEBACCESSLOG_H
+
+#include "../private/qtwebservicefwd.h"
+
+#include <QAtomicInteger>
+#include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+#include <QWaitCondition>
+
+class QWebAccessLog_Writer;
+
+/**
+ * @brief The QWebAccessLog class writes one line per response to a file, see
+ * QWebServiceConfig::accessLog().
+ *
+ * Routers only copy a Record into a lock-free ring buffer. A background
+ * thread drains it in batches, formats the lines and writes them. If the
+ * ring is full the record is dropped and counted instead of blocking the
+ * request.
+ */
+class QTWEBSERVICE_API QWebAccessLog {
+
+public:
+
+    typedef QSharedPointer<QWebAccessLog> Ptr;
+
+    //!< Time, peer, method, route, path, status, bytes and latency
+    static const QString DEFAULT_FORMAT;
+
+    //!< Format writing a JSON object per line instead of a pattern
+    static const QString JSON_FORMAT;
+
+    /**
+     * @brief The Settings class holds the options of the log, set through
+     * QWebServiceConfig::accessLog().
+     */
+    class Settings {
+    public:
+
+        Settings()
+            : format(DEFAULT_FORMAT),
+              sampleEvery(1),
+              capacity(16384),
+              flushInterval(100) {
+
+        }
+
+        //!< File appended to, logging is off if empty
+        QString fileName;
+
+        /**
+         * Pattern of a line, or JSON_FORMAT. Placeholders are `%t` time
+         * (ISO 8601, UTC), `%a` peer address, `%m` method, `%r` route as
+         * registered, `%U` path requested with spaces and control
+         * characters percent-encoded, `%s` status, `%b` body bytes, `%D`
+         * latency in microseconds and `%%`.
+         */
+        QString format;
+
+        //!< Log one of every `sampleEvery` responses per worker, 5xx always
+        int sampleEvery;
+
+        //!< Records buffered, rounded up to a power of two
+        int capacity;
+
+        //!< Milliseconds between flushes
+        int flushInterval;
+    };
+
+    /**
+     * @brief The Record class is a single response, formatted by the writer
+     * thread
+     */
+    class Record {
+    public:
+
+        Record()
+            : time(0),
+              method(-1),
+              status(0),
+              bytes(0),
+              latency(0) {
+
+        }
+
+        //!< Milliseconds since the epoch
+        qint64 time;
+
+        //!< %QWebService::HttpMethod
+        int method;
+
+        //!< Route as registered, empty if none matched
+        QString route;
+
+        //!< Only filled if the format has `%U`
+        QString path;
+
+        QString peer;
+
+        int status;
+
+        qint64 bytes;
+
+        //!< Nanoseconds from the request head to the response
+        qint64 latency;
+    };
+
+    /**
+     * @brief QWebAccessLog Opens `settings.fileName` and starts the writer
+     * thread
+     */
+    explicit QWebAccessLog(const Settings &settings);
+
+    /**
+     * Stops the writer thread once everything buffered is written.
+     */
+    ~QWebAccessLog();
+
+    const Settings &settings() const {
+        return m_settings;
+    }
+
+    //!< True if the format needs Record::path
+    bool needsPath() const {
+        return m_needsPath;
+    }
+
+    /**
+     * @brief append Queues `record`, safe from any thread and never blocks
+     * @return False if the buffer was full and the record dropped
+     */
+    bool append(const Record &record);
+
+    //!< Records dropped because the buffer was full
+    quint64 dropped() const {
+        return m_dropped.load();
+    }
+
+    /**
+     * @brief format Formats `record` as a line of `format`, without the
+     * line break
+     */
+    static QByteArray format(const QString &format, const Record &record);
+
+private:
+    /// @cond nodoc
+    friend class QWebAccessLog_Writer;
+    /// @endcond
+
+    Q_DISABLE_COPY(QWebAccessLog)
+
+    /**
+     * @brief The Slot class is a ring entry, `sequence` tells whether it
+     * is free for the producer at that position or holds a record for the
+     * consumer.
+     */
+    class Slot {
+    public:
+        QAtomicInteger<quint64> sequence;
+        Record record;
+    };
+
+    //!< Body of the writer thread
+    void run();
+
+    //!< Formats and writes every buffered record
+    void drain();
+
+    const Settings m_settings;
+
+    const bool m_needsPath;
+
+    Slot *m_slots;
+
+    const quint64 m_mask;
+
+    //!< Next position written by a producer
+    QAtomicInteger<quint64> m_head;
+
+    //!< Next position read by the writer, only used by it
+    quint64 m_tail;
+
+    QAtomicInteger<quint64> m_dropped;
+
+    QFile m_file;
+
+    //!< Wakes the writer early on shutdown
+    QMutex m_lock;
+    QWaitCondition m_wake;
+    bool m_stopping;
+
+    QWebAccessLog_Writer *m_writer;
+};
+
+#endif // QWEBACCESSLOG_H
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2014 Kevin Brightwell <kevin.brightwell2@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef QWEBCOMPRESSION_H
+#define QWEBCOMPRESSION_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+#include "../private/qtwebservicefwd.h"
+
+/**
+ * @brief The QWebCompression class negotiates and applies the
+ * `Content-Encoding` of responses, see QWebServiceConfig::compression().
+ */
+class QTWEBSERVICE_API QWebCompression {
+
+public:
+
+    enum Encoding {
+        IDENTITY = 0,
+        GZIP,
+        DEFLATE
+    };
+
+    /**
+     * @brief The Settings class holds the compression options of a service
+     */
+    class Settings {
+    public:
+
+        Settings()
+            : level(0),
+              minSize(1024),
+              types(defaultTypes()),
+              precompressed(false) {
+
+        }
+
+        //!< zlib level from 1 (fastest) to 9 (smallest), 0 does not compress
+        int level;
+
+        //!< Smallest body in bytes that is compressed
+        qint64 minSize;
+
+        //!< Content types compressed, entries ending in `/` match any subtype
+        QStringList types;
+
+        //!< Send `<file>.gz` for QWebResponse::writeFile() if it exists
+        bool precompressed;
+
+        inline
+        bool enabled() const {
+            return level > 0 || precompressed;
+        }
+    };
+
+    //!< Text based types, `text/`, JSON, JavaScript, XML and SVG
+    static QStringList defaultTypes();
+
+    /**
+     * @brief negotiate Picks the encoding for an `Accept-Encoding` header,
+     * gzip wins over deflate if both are equally acceptable. A coding listed
+     * by name takes its own weight, `*` only covers those that are not.
+     */
+    static Encoding negotiate(const QString &acceptEncoding);
+
+    /**
+     * @brief isCompressible True if `contentType`, parameters aside, is one
+     * of `types`
+     */
+    static bool isCompressible(const QString &contentType, const QStringList &types);
+
+    /**
+     * @brief compress Compresses `data` in a single pass
+     * @return The compressed data, empty on failure
+     */
+    static QByteArray compress(const QByteArray &data, const Encoding encoding, const int level);
+
+    //!< Value of `Content-Encoding` for `encoding`, empty for IDENTITY
+    static QString name(const Encoding encoding);
+
+    //!< Adds `Accept-Encoding` to the `Vary` header unless it is there
+    static void addVary(QHash<QString, QString> *headers);
+
+private:
+
+    QWebCompression();
+};
+
+#endif // QWEBCOMPRESSION_H
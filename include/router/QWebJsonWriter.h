@@ -0,0 +1,129 @@
+/*
+ * Copyright 2014 Kevin Brightwell <kevin.brightwell2@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef QWEBJSONWRITER_H
+#define QWEBJSONWRITER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVarLengthArray>
+
+#include "../private/qtwebservicefwd.h"
+
+/**
+ * @brief The QWebJsonWriter class writes compact JSON straight into a UTF-8
+ * buffer, without building a %QJsonObject or %QJsonDocument first. Pass it to
+ * QWebResponse::writeJson once done.
+ *
+ * Calls must form a valid document, nothing is checked beyond keeping the
+ * separators right:
+ *
+ *     QWebJsonWriter json;
+ *     json.beginObject()
+ *             .field("id", 42)
+ *             .key("tags").beginArray().value("a").value("b").endArray()
+ *         .endObject();
+ */
+class QTWEBSERVICE_API QWebJsonWriter {
+
+public:
+
+    /**
+     * @brief QWebJsonWriter
+     * @param reserve Bytes to reserve up front
+     */
+    explicit QWebJsonWriter(const int reserve = 256);
+
+    QWebJsonWriter &beginObject();
+    QWebJsonWriter &endObject();
+
+    QWebJsonWriter &beginArray();
+    QWebJsonWriter &endArray();
+
+    /**
+     * @brief key Writes the key of the next value of an object
+     */
+    QWebJsonWriter &key(const QString &name);
+    QWebJsonWriter &key(const char *name);
+
+    QWebJsonWriter &value(const QString &str);
+    QWebJsonWriter &value(const char *str);
+    QWebJsonWriter &value(const bool b);
+    QWebJsonWriter &value(const int i);
+    QWebJsonWriter &value(const long i);
+    QWebJsonWriter &value(const qint64 i);
+
+    /**
+     * @brief value Writes an unsigned number, one overload per width so
+     * `size_t` and `quint64` resolve on every platform.
+     */
+    QWebJsonWriter &value(const uint i);
+    QWebJsonWriter &value(const ulong i);
+    QWebJsonWriter &value(const quint64 i);
+
+    /**
+     * @brief value Writes a number, non-finite values are written as `null`
+     * like %QJsonDocument does.
+     */
+    QWebJsonWriter &value(const double d);
+
+    QWebJsonWriter &nullValue();
+
+    //!< Same as `key(name).value(val)`
+    template <typename K, typename V>
+    inline
+    QWebJsonWriter &field(const K &name, const V &val) {
+        return key(name).value(val);
+    }
+
+    //!< JSON written so far
+    inline
+    const QByteArray &data() const {
+        return m_out;
+    }
+
+private:
+
+    //!< Writes a `,` if a value came before in the current container
+    void separate();
+
+    void openContainer(const char open);
+
+    void closeContainer(const char close);
+
+    //!< Writes `magnitude` in decimal, with a `-` if `negative`
+    void writeInteger(const quint64 magnitude, const bool negative);
+
+    //!< Writes `str` quoted and escaped, encoded as UTF-8
+    void writeString(const QChar *str, const int length);
+
+    QByteArray m_out;
+
+    //!< Per open container, true until its first element is written
+    QVarLengthArray<bool, 16> m_first;
+
+    //!< True right after a key, its value needs no separator
+    bool m_afterKey;
+};
+
+#endif // QWEBJSONWRITER_H
@@ -0,0 +1,171 @@
+/*
+ * Copyright 2014 Kevin Brightwell <kevin.brightwell2@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef QWEBMETRICS_H
+#define QWEBMETRICS_H
+
+#include "../private/qtwebservicefwd.h"
+
+#include <QAtomicInteger>
+#include <QAtomicPointer>
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief The QWebMetrics class counts requests, status codes, bytes sent
+ * and latency per registered route, see QWebServiceConfig::metrics().
+ *
+ * Every router, so every worker thread, writes to its own Shard without
+ * locks or atomic read-modify-writes. Only exporting reads all of them.
+ */
+class QTWEBSERVICE_API QWebMetrics {
+
+public:
+
+    typedef QSharedPointer<QWebMetrics> Ptr;
+
+    //!< Latency buckets per power of two, about 19% apart
+    static const int SUB_BUCKETS = 4;
+
+    //!< Latency buckets from 1 us, the last one holds everything above ~2 min
+    static const int BUCKET_COUNT = SUB_BUCKETS + 25 * SUB_BUCKETS;
+
+    //!< Status codes counted apart, those %QHttpResponse::StatusCode names
+    static const int STATUS_CODE_COUNT = 51;
+
+    /**
+     * @brief The Counters class holds the numbers of a single route in a
+     * single shard
+     */
+    class Counters {
+    public:
+
+        Counters();
+
+        //!< Responses per status code, see statusIndex(), the last one
+        //!< counts codes that are not known
+        QAtomicInteger<quint64> responses[STATUS_CODE_COUNT + 1];
+
+        QAtomicInteger<quint64> bytes;
+
+        //!< Sum of the latencies in nanoseconds
+        QAtomicInteger<quint64> latencySum;
+
+        //!< Latencies in microseconds, see bucketOf()
+        QAtomicInteger<quint64> buckets[BUCKET_COUNT];
+    };
+
+    /**
+     * @brief The Shard class is written by a single thread, read by any
+     */
+    class Shard {
+    public:
+
+        explicit Shard(const int routeCount);
+
+        ~Shard();
+
+        /**
+         * @brief record Counts a response, only called by the owning thread
+         * @param route Id from QWebMetrics::addRoute()
+         * @param status HTTP status sent
+         * @param bytes Bytes of the body sent
+         * @param latency Nanoseconds from the request to the response
+         */
+        void record(const int route, const int status, const qint64 bytes, const qint64 latency);
+
+    private:
+        /// @cond nodoc
+        friend class QWebMetrics;
+        /// @endcond
+
+        Q_DISABLE_COPY(Shard)
+
+        const int m_routeCount;
+
+        //!< Created by the owning thread on the first response of a route
+        QAtomicPointer<Counters> *m_routes;
+    };
+
+    QWebMetrics();
+
+    ~QWebMetrics();
+
+    /**
+     * @brief addRoute Registers a route, before any shard is added
+     * @param method Label of the method, for example `GET`
+     * @param route Route as registered, not the path requested
+     * @return Id of the route
+     */
+    int addRoute(const QString &method, const QString &route);
+
+    /**
+     * @brief addShard Creates a shard for a thread, owned by `this`
+     */
+    Shard *addShard();
+
+    /**
+     * @brief bucketOf Bucket of a latency in microseconds. Values below
+     * SUB_BUCKETS have their own bucket, above the top two bits after the
+     * leading one pick one of SUB_BUCKETS per power of two.
+     */
+    static int bucketOf(const quint64 usec);
+
+    //!< Exclusive upper bound in microseconds of a bucket, 0 for the last one
+    static quint64 bucketLimit(const int bucket);
+
+    /**
+     * @brief statusIndex Counter of a status code, STATUS_CODE_COUNT for one
+     * that is not known
+     */
+    static int statusIndex(const int status);
+
+    /**
+     * @brief toPrometheus Sums every shard in the Prometheus text format,
+     * version 0.0.4. Routes without responses are left out.
+     */
+    QByteArray toPrometheus() const;
+
+private:
+
+    Q_DISABLE_COPY(QWebMetrics)
+
+    class Route {
+    public:
+        QString method;
+        QString route;
+    };
+
+    QVector<Route> m_routes;
+
+    //!< Guards `m_shards`, taken when a worker starts and when exporting
+    mutable QMutex m_lock;
+
+    QList<Shard *> m_shards;
+};
+
+#endif // QWEBMETRICS_H
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2014 Kevin Brightwell <kevin.brightwell2@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef QWEBMIDDLEWARE_H
+#define QWEBMIDDLEWARE_H
+
+#include <QSharedPointer>
+#include <QVector>
+
+#include <functional>
+
+#include "../private/qtwebservicefwd.h"
+
+/**
+ * @brief The QWebMiddleWare class defines the functions run before a route's
+ * handler. Each one may look at or change the request and response, and
+ * returns false to stop the chain: the handler is then skipped and the
+ * response is written as the middleware left it (e.g. a 401 or a cached
+ * answer).
+ *
+ * Middleware is registered with QWebServiceConfig::use() for every route or
+ * QWebServiceConfig::middleware() for a single one. When the service is built
+ * both are flattened into one %Chain per route, so a request only runs a
+ * loop over plain function objects.
+ */
+class QTWEBSERVICE_API QWebMiddleWare {
+
+public:
+
+    /// Signature of a middleware function, return false to skip the handler
+    typedef std::function<bool(const QSharedPointer<QWebRequest> &,
+                               const QSharedPointer<QWebResponse> &)> Function;
+
+    //!< Middleware of a route in the order it runs
+    typedef QVector<Function> Chain;
+
+    /**
+     * @brief run Runs `chain` in order until a function returns false
+     * @return True if the handler should be called
+     */
+    static inline
+    bool run(const Chain &chain,
+             const QSharedPointer<QWebRequest> &req,
+             const QSharedPointer<QWebResponse> &resp) {
+        for (const Function &func : chain) {
+            if (!func(req, resp)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+private:
+    QWebMiddleWare();
+};
+
+#endif // QWEBMIDDLEWARE_H
@@ -0,0 +1,166 @@
+/*
+ * Copyright 2014 Kevin Brightwell <kevin.brightwell2@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef QWEBMULTIPARTPARSER_H
+#define QWEBMULTIPARTPARSER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+
+#include "../private/qtwebservicefwd.h"
+
+/**
+ * @brief The QWebMultipartParser class parses a `multipart/form-data` (or any
+ * other `multipart/` type) body incrementally. Data is passed to feed() as it
+ * arrives and every part is reported through signals, its content in chunks,
+ * so a part is never held in memory as a whole. Only a tail as long as the
+ * boundary, and the headers of the current part, are kept between calls.
+ *
+ * See QWebRequest::multipart() to parse a request body.
+ */
+class QTWEBSERVICE_API QWebMultipartParser : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /**
+     * @brief The Part class describes a part, from its headers
+     */
+    class Part {
+    public:
+
+        //!< All headers of the part, names are lower case
+        QHash<QByteArray, QByteArray> headers;
+
+        //!< `name` parameter of `Content-Disposition`, the form field
+        QString name;
+
+        //!< `filename` parameter of `Content-Disposition`, empty if not a file
+        QString fileName;
+
+        //!< `Content-Type` of the part, empty if not set
+        QByteArray contentType;
+    };
+
+    /**
+     * @brief QWebMultipartParser
+     * @param boundary Boundary of the body, without the leading `--`
+     * @param parent QObject parent
+     */
+    explicit QWebMultipartParser(const QByteArray &boundary, QObject *parent = nullptr);
+
+    virtual
+    ~QWebMultipartParser();
+
+    /**
+     * @brief boundaryFrom Reads the boundary out of a `Content-Type` header
+     * @return The boundary, empty if `contentType` is not a multipart type
+     */
+    static QByteArray boundaryFrom(const QByteArray &contentType);
+
+    //!< True once the closing boundary was read
+    inline
+    bool isFinished() const {
+        return m_state == DONE;
+    }
+
+    //!< True if the body was malformed, no more signals are emitted
+    inline
+    bool hasError() const {
+        return m_state == FAILED;
+    }
+
+public slots:
+
+    /**
+     * @brief feed Parses the next bytes of the body
+     */
+    void feed(const QByteArray &data);
+
+    /**
+     * @brief end Marks the end of the body, an error is reported if the
+     * closing boundary is missing
+     */
+    void end();
+
+signals:
+
+    //!< A new part starts
+    void partBegin(const QWebMultipartParser::Part &part);
+
+    //!< Next chunk of the content of the current part
+    void partData(const QByteArray &chunk);
+
+    //!< The current part is complete
+    void partEnd();
+
+    //!< The closing boundary was read
+    void finished();
+
+    //!< The body is malformed, parsing stops
+    void error(const QString &message);
+
+private:
+
+    enum State {
+        //!< Skipping the preamble until the first boundary
+        PREAMBLE,
+
+        //!< Right after a boundary, `\r\n` or the closing `--` follow
+        AFTER_BOUNDARY,
+
+        //!< Reading the headers of a part
+        HEADERS,
+
+        //!< Reading the content of a part
+        CONTENT,
+
+        DONE,
+
+        FAILED
+    };
+
+    //!< Largest header block of a part
+    static const int MAX_HEADER_SIZE = 16 * 1024;
+
+    //!< Runs the state machine over `m_buffer`, returns the bytes consumed
+    int parse();
+
+    void fail(const QString &message);
+
+    //!< Fills `part` from a raw header block
+    static void parseHeaders(const char *data, const int size, Part *part);
+
+    //!< `\r\n--` followed by the boundary
+    const QByteArray m_delimiter;
+
+    //!< Bytes fed but not consumed yet
+    QByteArray m_buffer;
+
+    State m_state;
+};
+
+#endif // QWEBMULTIPARTPARSER_H
@@ -36,6 +36,8 @@
 
 #include "../private/qtwebservicefwd.h"
 
+#include "QWebRoute.h"
+
 class QTWEBSERVICE_API QWebRequest : public QObject
 {
     Q_OBJECT
@@ -56,12 +58,36 @@ public:
                                       const QStringList &splat,
                                       QObject *parent = 0);
 
+    /**
+     * @brief create Create a new instance of %QHttpRoutedRequest
+     * @param httpReq %QHttpRequest as the base
+     * @param match Captures of the matched route, they are only copied out
+     *      when urlParams() or urlSplat() are first called. An empty match
+     *      means there are no captures.
+     * @param parent QObject parent
+     * @return Shared pointer
+     */
+    static QSharedPointer<QWebRequest> create(QHttpRequest *httpReq,
+                                      const QWebRoute::Match &match,
+                                      QObject *parent = 0);
+
+    /**
+     * @brief parseQuery Parses `application/x-www-form-urlencoded` data, as
+     * found in a query string or form body. Percent escapes and `+` are
+     * decoded, values are read as UTF-8. A key without `=` has an empty
+     * value, repeated keys are all kept (see %QHash::values).
+     * @param query Raw, still encoded, data
+     * @param out Pairs are added to it
+     */
+    static void parseQuery(const QByteArray &query, QHash<QString, QString> *out);
+
     /**
      * @brief urlParams All parameters passed in as "router" variables
      * @return %QHash of all variables `<key, value>`
      */
     inline
     const QHash<QString, QString> &urlParams() {
+        parseMatch();
         return m_urlParams;
     }
 
@@ -72,17 +98,23 @@ public:
      */
     inline
     const QStringList &urlSplat() {
+        parseMatch();
         return m_splat;
     }
 
     /**
      * @brief queryParams Parameters found in the query string of a URL and
-     * the body of a POST/PUT request
+     * the form encoded body of a POST/PUT request, parsed on the first call.
+     * A repeated key keeps every value, %QHash::value returns the last one.
      * @return %QHash, possibly empty, with key-value pairs.
      */
     inline
     const QHash<QString, QString> &queryParams() {
-        return m_urlParams;
+        if (!m_queryParsed) {
+            parseQueryParams();
+        }
+
+        return m_queryParams;
     }
 
     /**
@@ -104,12 +136,41 @@ public:
     }
 
     /**
-     * @brief body return the body content
+     * @brief body return the body content, complete by the time the handler
+     * is called. Empty for routes that stream their body.
      * @return QString of the body content
      */
     inline
     const QString body() {
-        return m_req->body();
+        return m_body;
+    }
+
+    /**
+     * @brief rawBody The body as it was received, without converting it to a
+     * %QString. Empty for routes that stream their body.
+     */
+    inline
+    const QByteArray &rawBody() const {
+        return m_body;
+    }
+
+    /**
+     * @brief multipart Parser for a `multipart/` body, created on the first
+     * call and owned by the request. For routes that stream their body it is
+     * fed by bodyData() and bodyEnd() from then on. For buffered bodies,
+     * connect to it and then pass rawBody() to
+     * %QWebMultipartParser::feed and call %QWebMultipartParser::end.
+     * @return `nullptr` if the body is not multipart, or there is no
+     *      %QHttpRequest
+     */
+    QWebMultipartParser *multipart();
+
+    /**
+     * @brief bodySize Number of body bytes received so far
+     */
+    inline
+    qint64 bodySize() const {
+        return m_bodySize;
     }
 
     inline
@@ -122,19 +183,93 @@ public:
 
 signals:
 
+    /**
+     * @brief bodyData emitted for each chunk of the body as it arrives, only
+     * for routes configured with QWebServiceConfig::streamBody. Nothing is
+     * buffered, the chunk has to be consumed here.
+     */
+    void bodyData(const QByteArray &chunk);
+
+    /**
+     * @brief bodyEnd emitted once the whole body was delivered through
+     * bodyData()
+     */
+    void bodyEnd();
+
+    /**
+     * @brief bodyAborted emitted instead of bodyEnd() if the body grew past
+     * the route's size limit, the client is answered with a 413 unless the
+     * handler already wrote a response
+     */
+    void bodyAborted();
+
 public slots:
 
 private:
+    /// @cond nodoc
+    friend class QWebRouter;
+    /// @endcond
+
     explicit QWebRequest(QHttpRequest *httpReq,
                          const QHash<QString, QString> &postParams,
                          const QHash<QString, QString> &urlParams,
                          const QStringList &splat,
                          QObject *parent = 0);
 
+    explicit QWebRequest(QHttpRequest *httpReq,
+                         const QWebRoute::Match &match,
+                         QObject *parent = 0);
+
+    //!< Fills `m_queryParams` from the URL and the body
+    void parseQueryParams();
+
+    /**
+     * @brief parseMatch Copies the values out of `m_match` the first time it
+     * is called.
+     */
+    inline
+    void parseMatch() {
+        if (!m_matchParsed) {
+            m_urlParams = m_match.urlParams();
+            m_splat = m_match.splat();
+            m_matchParsed = true;
+        }
+    }
+
     QHttpRequest * const m_req;
-    const QHash<QString, QString> m_urlParams;
-    const QHash<QString, QString> m_postParams;
-    const QStringList m_splat;
+    const QWebRoute::Match m_match;
+    bool m_matchParsed;
+    QHash<QString, QString> m_urlParams;
+    QStringList m_splat;
+
+    bool m_queryParsed;
+    QHash<QString, QString> m_queryParams;
+
+    //!< Body received so far, filled by the router
+    QByteArray m_body;
+
+    //!< Number of body bytes received, also counted for streamed bodies
+    qint64 m_bodySize;
+
+    //!< Set by the router if the body went over the route's size limit
+    bool m_bodyRejected;
+
+    //!< Set by the router if the body is delivered through bodyData()
+    bool m_bodyStreamed;
+
+    QWebMultipartParser *m_multipart;
+
+    //!< Route counted in QWebMetrics, -1 if metrics are off
+    int m_metricsId;
+
+    //!< Nanoseconds on the router's clock when the request head arrived
+    qint64 m_started;
+
+    //!< Route that matched, null if none did. Owned by the router.
+    const QWebRoute *m_route;
+
+    //!< Phases of the request, null unless it was sampled for tracing
+    QSharedPointer<QWebTrace> m_trace;
 
 };
 
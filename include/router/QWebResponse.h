@@ -26,6 +26,8 @@
 
 #include "../private/qtwebservicefwd.h"
 
+#include "QWebCompression.h"
+
 #include <functional>
 
 #include <QObject>
@@ -36,9 +38,13 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QDomDocument>
+#include <QAtomicInt>
+#include <QDateTime>
 
 #include <QHttpServer/qhttpresponse.h>
 
+class QWebResponse_Queue;
+
 class QTWEBSERVICE_API QWebResponse : public QObject
 {
     Q_OBJECT
@@ -51,6 +57,9 @@ public:
         //!< Tried to write response, no data was set
         NO_DATA_SET,
 
+        //!< The response was already written
+        ALREADY_WRITTEN,
+
         //!< QFile was attempted to be read, and was non-existant
         FILE_DOES_NOT_EXIST = 10,
         FILE_COULD_NOT_OPEN,
@@ -60,6 +69,15 @@ public:
 
     typedef QHttpResponse::StatusCode StatusCode;
 
+    //!< Produces the next chunk of a streamed response, empty when there is no more
+    typedef std::function<QByteArray()> ChunkSource;
+
+    //!< Bytes read from a file per write when streaming it
+    static const qint64 STREAM_CHUNK_SIZE = 64 * 1024;
+
+    //!< Chunks pushed with write() that wait to be sent before it refuses more, by default
+    static const int STREAM_QUEUE_SIZE = 16;
+
     /**
      * @brief create Create a new instance of %QWebRequest
      * @return Shared pointer
@@ -80,17 +98,83 @@ public:
     void setStatusCode(StatusCode code);
 
     /**
-     * @brief writeFile Enqueues the %QFile to be written to the output stream as a byte array. This is done by reading
-     * the file to a bytestream, and writing it after.
-     * @param file File that will be read, this will emit the signal to middleware hooks
+     * @brief writeFile Enqueues the file to be streamed to the output in chunks of STREAM_CHUNK_SIZE bytes. The next
+     * chunk is only read once the previous one was written to the socket, so memory use does not depend on the file
+     * size. `Content-Length` is the size of the file when it is opened. Streamed data does not pass through
+     * responseDataPrepared().
+     *
+     * With QWebServiceConfig::precompressed(), `<fileName>.gz` is sent instead if it exists and the client
+     * accepts gzip.
+     * @param fileName Path of the file to send, it is opened when the response is written
+     * @param contentType Value of the `Content-Type` header, unless one was set
+     * @return
+     */
+    bool writeFile(const QString &fileName, const QString contentType = "application/octet-stream");
+
+    /**
+     * @brief writeFile Enqueues `length` bytes of the file from `offset` to be streamed, for range requests. The
+     * status and `Content-Range` are left to the caller, precompressed files are not used.
+     */
+    bool writeFile(const QString &fileName, const QString contentType, const qint64 offset, const qint64 length);
+
+    inline
+    bool writeFile(const QFile &file, const QString contentType = "application/octet-stream") {
+        return writeFile(file.fileName(), contentType);
+    }
+
+    /**
+     * @brief writeStream Enqueues a response produced a chunk at a time, sent with `Transfer-Encoding: chunked` as
+     * the length is not known up front. `source` is called for the first chunk once the head is written, and for
+     * each following one only after the socket wrote everything before it. It returns an empty %QByteArray when
+     * done. Chunks do not pass through responseDataPrepared().
+     *
+     * This can be used next to the other write methods, the last one called wins.
+     * @param source Called on the thread handling the request, until it returns an empty chunk
+     * @param contentType Value of the `Content-Type` header, unless one was set
      * @return
      */
-    bool writeFile( QFile file);
+    bool writeStream(const ChunkSource &source, const QString contentType = "application/octet-stream");
+
+    /**
+     * @brief beginStream Enqueues a response whose chunks are pushed with write() and closed with end(), for
+     * producers that cannot hand out a chunk whenever writeStream() asks. It is sent with `Transfer-Encoding:
+     * chunked`, the head once the response is written and every chunk once the socket wrote the one before it.
+     * At most `queueSize` chunks wait to be sent, write() refuses more and writable() is emitted when there is
+     * room again.
+     *
+     * This can be used next to the other write methods, the last one called wins.
+     * @param contentType Value of the `Content-Type` header, unless one was set
+     * @param queueSize Chunks queued before write() refuses more
+     * @return
+     */
+    bool beginStream(const QString contentType = "application/octet-stream",
+                     const int queueSize = STREAM_QUEUE_SIZE);
+
+    /**
+     * @brief write Queues `chunk` of a response begun with beginStream(), safe from any thread. Empty chunks are
+     * skipped.
+     * @return False if `chunk` was not queued: the queue is full, end() was called, the client went away or no
+     *      stream was begun
+     */
+    bool write(const QByteArray &chunk);
+
+    /**
+     * @brief end Ends a response begun with beginStream() after the queued chunks, safe from any thread
+     */
+    void end();
 
     bool writeText(const QString text, const QString contentType = "text/plain");
 
+    /**
+     * @brief writeBytes Enqueues `data` as it is
+     */
+    bool writeBytes(const QByteArray &data, const QString contentType = "application/octet-stream");
+
 //    bool writeText(const QByteArray &text);
 
+    /**
+     * @brief writeJson Enqueues `doc`, serialized with jsonFormat() when the response is written
+     */
     bool writeJson(const QJsonDocument doc);
 
     inline
@@ -98,6 +182,34 @@ public:
         return writeJson(QJsonDocument(obj));
     }
 
+    /**
+     * @brief writeJson Enqueues JSON written by a %QWebJsonWriter as it is, it is always compact
+     */
+    bool writeJson(const QWebJsonWriter &writer);
+
+    /**
+     * @brief setJsonFormat Sets how %QJsonDocument responses are serialized, defaults to the service's
+     * QWebServiceConfig::jsonFormat.
+     */
+    void setJsonFormat(const QJsonDocument::JsonFormat format);
+
+    inline
+    QJsonDocument::JsonFormat jsonFormat() const {
+        return m_jsonFormat;
+    }
+
+    /**
+     * @brief setETag Sets the `ETag` header, quoting `tag` unless it already is. On routes with
+     * QWebServiceConfig::conditional() it replaces the computed tag.
+     */
+    void setETag(const QString &tag);
+
+    /**
+     * @brief setLastModified Sets the `Last-Modified` header, checked against `If-Modified-Since` on routes with
+     * QWebServiceConfig::conditional().
+     */
+    void setLastModified(const QDateTime &time);
+
 //    bool writeXML(const QDomDocument &doc);
 
     /**
@@ -107,7 +219,35 @@ public:
     bool isValidResponse();
 
     /**
-     * @brief writeToResponse writes the stored data to the QHttpResponse instance
+     * @brief defer Marks the response as asynchronous, it is not written when
+     * the handler returns but once finish() is called. If that does not
+     * happen within QWebServiceConfig::asyncTimeout the client is sent a 504
+     * and the response is dropped.
+     */
+    void defer();
+
+    /**
+     * @brief isDeferred
+     * @return True if defer() was called
+     */
+    bool isDeferred() const;
+
+    /**
+     * @brief finish Completes a deferred response, after the status, headers
+     * and data are set. Safe to call from any thread, the response is written
+     * on the thread that handles the request. Only the first call counts.
+     */
+    void finish();
+
+    /**
+     * @brief isFinished
+     * @return True once finish() was called, or the response timed out
+     */
+    bool isFinished() const;
+
+    /**
+     * @brief writeToResponse writes the stored data to the QHttpResponse instance. Responses that are not streamed
+     * are compressed here if the service enables it, the client accepts it and no `Content-Encoding` was set.
      * @param httpResponse Response to write data to
      * @return
      */
@@ -126,12 +266,87 @@ signals:
      */
     void responseDataPrepared(QSharedPointer<QWebRequest> req, QByteArray in, QSharedPointer<QByteArray> &out);
 
+    /**
+     * @brief finished emitted by finish() for a deferred response, possibly
+     * from another thread
+     */
+    void finished();
+
+    /**
+     * @brief writable emitted once the queue of a stream begun with beginStream() has room again after write()
+     * refused a chunk, from the thread handling the request
+     */
+    void writable();
+
 private:
+    /// @cond nodoc
+    friend class QWebRouter;
+    friend class QWebStaticFiles;
+    /// @endcond
+
     QWebResponse();
 
+    /**
+     * @brief expire Marks a deferred response as finished without emitting
+     * finished(), used when it timed out.
+     * @return False if finish() was called first
+     */
+    bool expire();
+
+    /**
+     * @brief isNotModified True if `request` is a `GET` or `HEAD` whose `If-None-Match` or `If-Modified-Since`
+     * matches the validators in `headers`
+     */
+    static bool isNotModified(const QHttpRequest *request, const QHash<QString, QString> &headers);
+
+    //!< Writes a 304 with `headers`, leaving out those about the body. `length` is the `Content-Length` of the
+    //!< representation it stands for, as the 200 would have sent it
+    static void writeNotModified(QHttpResponse *httpResponse, const QHash<QString, QString> &headers,
+                                 const qint64 length);
+
     std::function<QByteArray(ResponseError *)> m_outFunc;
+
+    //!< Opens a streamed response, setting its length or -1 if unknown. Used
+    //!< instead of `m_outFunc` if set.
+    std::function<ChunkSource(ResponseError *, qint64 *)> m_streamFunc;
+
+    //!< Chunks pushed with write(), set by beginStream() and shared with the stream writing them
+    QSharedPointer<QWebResponse_Queue> m_queue;
+
     QHash<QString, QString> m_headers;
     StatusCode m_status;
+
+    QJsonDocument::JsonFormat m_jsonFormat;
+
+    bool m_deferred;
+
+    //!< Set once by finish() or expire(), whichever is first
+    QAtomicInt m_finished;
+
+    bool m_written;
+
+    //!< Called with what was sent once a response that is not streamed is
+    //!< written, used by the router to fill its response cache
+    std::function<void(StatusCode, const QHash<QString, QString> &, const QByteArray &)> m_onWritten;
+
+    //!< Compression options of the router, null if it does not compress
+    const QWebCompression::Settings *m_compression;
+
+    //!< Encoding accepted by the client, set when writing
+    QWebCompression::Encoding m_encoding;
+
+    //!< Add validators and answer conditional requests with a 304, set by the router
+    bool m_conditional;
+
+    //!< Request being answered, only valid while writing
+    const QHttpRequest *m_httpRequest;
+
+    //!< Status and body bytes actually sent, for QWebMetrics
+    int m_sentStatus;
+    qint64 m_sentBytes;
+
+    //!< Phases of the request, set by the router if it is traced
+    QSharedPointer<QWebTrace> m_trace;
 };
 
 #endif // QWEBRESPONSE_H
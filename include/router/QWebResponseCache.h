@@ -0,0 +1,147 @@
+/*
+ * Copyright 2014 Kevin Brightwell <kevin.brightwell2@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef QWEBRESPONSECACHE_H
+#define QWEBRESPONSECACHE_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QString>
+
+#include <QHttpServer/qhttpresponse.h>
+
+#include "../private/qtwebservicefwd.h"
+
+/**
+ * @brief The QWebResponseCache class keeps complete responses, status,
+ * headers and body, for a limited time. When the total size of the bodies
+ * goes over the limit the least recently used responses are dropped.
+ *
+ * A cache is not thread-safe, every %QWebRouter, and so every worker thread,
+ * has its own.
+ */
+class QTWEBSERVICE_API QWebResponseCache {
+
+public:
+
+    //!< Headers as kept by %QWebResponse
+    typedef QHash<QString, QString> Headers;
+
+    /**
+     * @brief The Entry class is a single cached response
+     */
+    class Entry {
+    public:
+
+        QHttpResponse::StatusCode status;
+
+        Headers headers;
+
+        QByteArray body;
+
+    private:
+        /// @cond nodoc
+        friend class QWebResponseCache;
+        /// @endcond
+
+        Entry()
+            : status(QHttpResponse::STATUS_OK), expires(0), cost(0),
+              prev(nullptr), next(nullptr) {
+
+        }
+
+        QString key;
+
+        //!< Time of QWebResponseCache::m_clock after which the entry is stale
+        qint64 expires;
+
+        //!< Bytes accounted for the entry
+        qint64 cost;
+
+        // least recently used list, m_head is the most recent
+        Entry *prev;
+        Entry *next;
+    };
+
+    /**
+     * @brief QWebResponseCache
+     * @param maxBytes Limit of the bodies and headers kept, roughly
+     */
+    explicit QWebResponseCache(const qint64 maxBytes);
+
+    ~QWebResponseCache();
+
+    /**
+     * @brief find Looks up a fresh response, marking it as recently used.
+     * Stale responses are dropped here.
+     * @return The response, `nullptr` if there is none. It is valid until
+     *      the cache is next changed.
+     */
+    const Entry *find(const QString &key);
+
+    /**
+     * @brief insert Stores a response, replacing one with the same key
+     * @param ttl Milliseconds the response stays fresh
+     */
+    void insert(const QString &key, const QHttpResponse::StatusCode status,
+                const Headers &headers, const QByteArray &body, const int ttl);
+
+    //!< Drops every response
+    void clear();
+
+    //!< Number of responses kept
+    inline
+    int count() const {
+        return m_entries.size();
+    }
+
+    //!< Bytes accounted for all responses
+    inline
+    qint64 size() const {
+        return m_bytes;
+    }
+
+private:
+
+    Q_DISABLE_COPY(QWebResponseCache)
+
+    void unlink(Entry *entry);
+
+    void pushFront(Entry *entry);
+
+    void remove(Entry *entry);
+
+    QHash<QString, Entry *> m_entries;
+
+    Entry *m_head;
+    Entry *m_tail;
+
+    const qint64 m_maxBytes;
+    qint64 m_bytes;
+
+    //!< Monotonic clock for expiry
+    QElapsedTimer m_clock;
+};
+
+#endif // QWEBRESPONSECACHE_H
@@ -30,6 +30,8 @@
 #include <QSharedPointer>
 #include <QList>
 #include <QHash>
+#include <QPair>
+#include <QVarLengthArray>
 #include <QReadWriteLock>
 #include <QDebug>
 
@@ -107,6 +109,128 @@ public:
         const QStringList m_groupVals;
     };
 
+    /**
+     * @brief The Match class is filled by QWebRoute::checkPath(path, match),
+     * it keeps captures as offsets into the matched path so matching does
+     * not allocate. Values are only copied out of the path when asked for.
+     *
+     * Capture 0 is the entire match. A match refers to the capture names of
+     * the route (or %QWebRouteIndex) that filled it and must not outlive it.
+     */
+    class Match {
+    public:
+
+        Match()
+            : m_names(nullptr) {
+
+        }
+
+        /**
+         * @brief reset Clears all captures
+         * @param path Path being matched, kept as a shallow copy
+         * @param names Name of each capture, empty for unnamed captures
+         */
+        inline
+        void reset(const QString &path, const QStringList *names) {
+            m_path = path;
+            m_names = names;
+            m_captures.clear();
+        }
+
+        /**
+         * @brief addCapture Appends a capture
+         * @param start Offset in the path, -1 if the capture did not participate
+         * @param length Length of the capture
+         */
+        inline
+        void addCapture(const int start, const int length) {
+            m_captures.append(qMakePair(start, length));
+        }
+
+        //!< Path that was matched
+        inline
+        const QString &path() const {
+            return m_path;
+        }
+
+        //!< Number of captures, including the entire match
+        inline
+        int size() const {
+            return m_captures.size();
+        }
+
+        //!< Name of capture `i`, empty if unnamed
+        inline
+        QString name(const int i) const {
+            return (m_names && i < m_names->size()) ? m_names->at(i) : QString();
+        }
+
+        //!< Value of capture `i` without copying, null if it did not participate
+        inline
+        QStringRef capturedRef(const int i) const {
+            const QPair<int, int> &capture = m_captures[i];
+            return capture.first < 0 ? QStringRef() : m_path.midRef(capture.first, capture.second);
+        }
+
+        //!< Value of capture `i`, null if it did not participate
+        inline
+        QString captured(const int i) const {
+            const QPair<int, int> &capture = m_captures[i];
+            return capture.first < 0 ? QString() : m_path.mid(capture.first, capture.second);
+        }
+
+        /**
+         * @brief urlParams Copies out all named captures
+         * @return Same as ParsedRoute::urlParams
+         */
+        QHash<QString, QString> urlParams() const;
+
+        /**
+         * @brief splat Copies out all unnamed captures
+         * @return Same as ParsedRoute::splat
+         */
+        QStringList splat() const;
+
+        /**
+         * @brief groups Copies out all captures
+         * @return Same as ParsedRoute::groups
+         */
+        QStringList groups() const;
+
+        /**
+         * @brief toParsedRoute Copies out everything into a new %ParsedRoute
+         */
+        QSharedPointer<ParsedRoute> toParsedRoute() const;
+
+    private:
+
+        QString m_path;
+
+        const QStringList *m_names;
+
+        QVarLengthArray<QPair<int, int>, 16> m_captures;
+    };
+
+    /**
+     * @brief The Level class describes a single `/` separated level of a route
+     * written in the path DSL (see docs/PathSpecifications.md).
+     */
+    class Level {
+    public:
+
+        //!< Name of the level, null if the level is not named
+        QString name;
+
+        //!< Valid specifications for the level, wildcards are kept as `*` and `+`
+        QStringList specs;
+
+        //!< True if the level produces a capture, either named or a splat
+        bool captured;
+    };
+
+    //!< Typedef for convenience
+    typedef QList<Level> LevelList;
+
     /// No-op
     virtual
     ~QWebRoute() { }
@@ -126,25 +250,90 @@ public:
      */
     virtual
     const QStringList variables() const = 0;
-    
+
+    /*!
+     * Levels of a route created from the path DSL, in order. Routes created
+     * from a regular expression have no levels.
+     */
+    inline
+    const LevelList &levels() const {
+        return _levels;
+    }
+
+    /*!
+     * Names of all captures, in order, starting with the entire match. Unnamed
+     * captures have an empty name. Cached when the route is created.
+     */
+    inline
+    const QStringList &captureNames() const {
+        return _captureNames;
+    }
+
     /*!
      * \brief checkPath Check that path values (not including root) for 
      * whether the path matches all underlying \ref QHttpRoutePath instances
      * and if variables are present, load them into the `vars` \ref QHash.
      * \param paths Individual paths to try and match
-     * \returns Valid pointer if found, caller must delete pointer
+     * \returns Valid pointer if found
+     */
+    inline
+    ParsedRoute::Ptr const checkPath(const QString &path) {
+        Match match;
+        if (!checkPath(path, &match)) {
+            return ParsedRoute::Ptr();
+        }
+
+        return match.toParsedRoute();
+    }
+
+    /*!
+     * \brief checkPath Checks if the path matches, without copying any of the
+     * captured values.
+     * \param path Path to match
+     * \param match Filled with the captures if the path matches
+     * \returns True if the path matches
+     */
+    virtual
+    bool checkPath(const QString &path, Match *match) = 0;
+
+    /*!
+     * True if the route is a plain literal path with no variables, wildcards
+     * or alternatives (i.e. `/v1/status`). Such a route only matches
+     * staticPath() exactly.
      */
     virtual
-    ParsedRoute::Ptr const checkPath(const QString &path) = 0;
+    bool isStatic() const {
+        return false;
+    }
+
+    /*!
+     * The only path a static route matches, normalized from `route()`. Empty
+     * if the route is not static.
+     */
+    virtual
+    QString staticPath() const {
+        return QString();
+    }
     
 protected:
 
-    explicit QWebRoute(const QString route)
-        : _route(route) {
+    explicit QWebRoute(const QString route, const LevelList &levels = LevelList())
+        : _route(route), _levels(levels) {
+
+        _captureNames += QString();
+        for (const Level &level : levels) {
+            if (level.captured) {
+                _captureNames += level.name;
+            }
+        }
     }
 
     const QString _route;
-    
+
+    const LevelList _levels;
+
+    QStringList _captureNames;
+
 };
 
 /**
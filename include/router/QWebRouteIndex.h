@@ -0,0 +1,139 @@
+/*
+ * Copyright 2014 Kevin Brightwell <kevin.brightwell2@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef QWEBROUTEINDEX_H
+#define QWEBROUTEINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QSharedPointer>
+#include <QString>
+
+#include "../private/qtwebservicefwd.h"
+
+#include "QWebRoute.h"
+
+/**
+ * @brief The QWebRouteIndex class finds the first matching route for a path
+ * among all of the routes registered for a single HTTP method.
+ *
+ * Routes created from the path DSL are compiled into a tree of `/` separated
+ * levels, so a path is matched in a single walk over its levels instead of
+ * running every route's regular expression. Routes created from a regular
+ * expression can not be indexed and are checked one after the other.
+ *
+ * With the COMBINED_REGEX strategy, DSL routes are instead compiled into one
+ * regular expression per batch of routes which is scanned once per path.
+ *
+ * Static routes (see QWebRoute::isStatic) are resolved when the index is built
+ * and answered from a hash table keyed on the path, before the tree or any
+ * regular expression is touched.
+ *
+ * The index keeps the first-match-in-registration-order semantics of a linear
+ * scan over the routes. An index is immutable once constructed.
+ */
+class QTWEBSERVICE_API QWebRouteIndex {
+
+public:
+
+    //!< typedef for Shared Pointer
+    typedef QSharedPointer<QWebRouteIndex> Ptr;
+
+    /**
+     * @brief The Strategy enum picks how DSL routes are matched
+     */
+    enum Strategy {
+        //!< Walk a tree of levels
+        LEVEL_TREE = 0,
+
+        //!< Scan a single regular expression holding every route
+        COMBINED_REGEX
+    };
+
+    /**
+     * @brief QWebRouteIndex Builds the index
+     * @param routes Routes in registration order
+     * @param strategy How to match DSL routes
+     */
+    explicit QWebRouteIndex(const QList<QWebRoute::Ptr> &routes, const Strategy strategy = LEVEL_TREE);
+
+    ~QWebRouteIndex();
+
+    /**
+     * @brief match Finds the first route, in registration order, that matches
+     *      `path`. Matching routes written in the path DSL does not allocate.
+     * @param path Path to match
+     * @param match Filled with the captures if a route matched, it must not
+     *      outlive the index
+     * @return Index of the matching route within the routes the index was
+     *      built from, -1 if no route matched
+     */
+    int match(const QString &path, QWebRoute::Match *match) const;
+
+    /**
+     * @brief match Same as match(path, match) but copies out the captures
+     * @param path Path to match
+     * @param parsed Set to the parsed route if a route matched
+     * @return Index of the matching route, -1 if no route matched
+     */
+    int match(const QString &path, QWebRoute::ParsedRoute::Ptr *parsed) const;
+
+private:
+
+    /**
+     * @brief searchRoutes Matches without the static table, see match()
+     */
+    int searchRoutes(const QString &path, QWebRoute::Match *match) const;
+
+    class Node;
+
+    class Automaton;
+
+    //!< Result of matching the path of a static route
+    typedef QPair<int, QWebRoute::Match> StaticMatch;
+
+    /// @cond nodoc
+    friend class QWebRouteIndex_Search;
+    /// @endcond
+
+    //!< All routes, in registration order
+    const QList<QWebRoute::Ptr> m_routes;
+
+    Node * const m_root;
+
+    const Strategy m_strategy;
+
+    //!< Combined routes for COMBINED_REGEX, in registration order
+    QList<Automaton *> m_automata;
+
+    //!< Routes that could not be put in the tree, with their index
+    QList<QPair<int, QWebRoute::Ptr> > m_regexRoutes;
+
+    //!< Paths of static routes to their resolved match
+    QHash<QString, StaticMatch> m_statics;
+
+    Q_DISABLE_COPY(QWebRouteIndex)
+};
+
+#endif // QWEBROUTEINDEX_H
@@ -28,6 +28,12 @@
 #include "../private/qtwebservicefwd.h"
 
 #include "QWebService.h"
+#include "QWebRouteIndex.h"
+#include "QWebMiddleWare.h"
+#include "QWebCompression.h"
+#include "QWebMetrics.h"
+#include "QWebAccessLog.h"
+#include "QWebTracer.h"
 
 #include <iostream>
 
@@ -35,7 +41,11 @@
 #include <QHash>
 #include <QList>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QPair>
+#include <QStringList>
+#include <QVector>
+#include <QJsonDocument>
 #include <QHttpServer/qhttpserver.h>
 
 
@@ -45,6 +55,8 @@ class QTWEBSERVICE_API QWebRouter : public QObject
     
     /// @cond nodoc
     friend class QWebServiceConfig;
+    friend class QWebWorker;
+    friend class QWebWorkerPool;
     /// @endcond
     
 public:
@@ -54,6 +66,98 @@ public:
     
     typedef QPair<QSharedPointer<QWebRoute>, RouteFunction> RoutePair;
     typedef QList<RoutePair> RoutePairList;
+
+    /**
+     * @brief The RouteEntry class is a single, immutable entry of the routing
+     * table.
+     */
+    class RouteEntry {
+    public:
+
+        RouteEntry()
+            : maxBodySize(-1),
+              streamBody(false),
+              cacheTtl(0),
+              conditional(false),
+              metricsId(-1) {
+
+        }
+
+        //!< Route the entry was created for, keeps the route alive
+        QSharedPointer<QWebRoute> route;
+
+        //!< Handler of the route
+        RouteFunction func;
+
+        //!< Largest request body accepted in bytes, -1 uses Settings::maxBodySize
+        qint64 maxBodySize;
+
+        //!< If true, the handler is called before the body arrives and reads
+        //!< it through QWebRequest::bodyData
+        bool streamBody;
+
+        //!< Global and route middleware, flattened, run before `func`
+        QWebMiddleWare::Chain middleware;
+
+        //!< Milliseconds a response is served from the cache, 0 if it is not cached
+        int cacheTtl;
+
+        //!< Query parameters that are part of the cache key
+        QStringList cacheKeys;
+
+        //!< Responses get an `ETag` and conditional requests a 304
+        bool conditional;
+
+        //!< Route counted in Settings::metrics, set by the router
+        int metricsId;
+    };
+
+    typedef QList<RouteEntry> RouteEntryList;
+
+    /**
+     * @brief The Settings class holds the service wide options of a router,
+     * set through %QWebServiceConfig.
+     */
+    class Settings {
+    public:
+
+        Settings()
+            : asyncTimeout(30000),
+              jsonFormat(QJsonDocument::Compact),
+              maxBodySize(-1),
+              cacheSize(0) {
+
+        }
+
+        //!< Milliseconds a deferred response may take before a 504 is sent,
+        //!< 0 waits forever
+        int asyncTimeout;
+
+        //!< Format of %QJsonDocument responses unless a handler changes it
+        QJsonDocument::JsonFormat jsonFormat;
+
+        //!< Largest request body accepted in bytes for routes without their
+        //!< own limit, -1 for no limit
+        qint64 maxBodySize;
+
+        //!< Bytes of responses cached per router, 0 disables the cache
+        qint64 cacheSize;
+
+        //!< Response compression, off unless enabled
+        QWebCompression::Settings compression;
+
+        //!< Per route counters shared by every worker, null if metrics are off
+        QWebMetrics::Ptr metrics;
+
+        //!< Access log shared by every worker, null if it is off
+        QWebAccessLog::Ptr accessLog;
+
+        //!< Phase tracing of sampled requests, null if it is off
+        QWebTracer::Ptr tracer;
+    };
+
+    //!< Number of slots in the routing table, one per %QWebService::HttpMethod
+    static const int METHOD_COUNT = QWebService::HttpMethod::HTTP_PATCH + 1;
     
     //!< Immediately returns HTTP status code 404
     static const RouteFunction DEFAULT_404; 
@@ -62,12 +166,32 @@ public:
     static const QRegExp DEFAULT_404_PATH_REPL;
        
     ~QWebRouter();
+
+    /**
+     * @brief findRoute Finds the entry handling `path` for `method` without
+     * allocating or touching any reference counts, apart from the result.
+     * @param method HTTP Method of the request
+     * @param path Path of the request
+     * @param match Filled with the captures if an entry was found
+     * @return The matching entry, `nullptr` if no route matched. The entry
+     *      lives as long as the router.
+     */
+    const RouteEntry *findRoute(const QWebService::HttpMethod method, const QString &path,
+                                QWebRoute::Match *match) const;
+
+    /**
+     * @brief methodName Name of `method` as used in an `Allow` header, empty
+     * for methods that can not be routed.
+     */
+    static QString methodName(const QWebService::HttpMethod method);
     
 private slots:
     
     /*!
      * Figures out the proper RouteHandler if installed, otherwise it will 
-     * trigger a 404 for the `resp` instance.
+     * trigger a 405 or 404 for the `resp` instance. This happens as soon as
+     * the headers arrive, the body is only buffered for a matched route and
+     * the handler is called once it is complete.
      * 
      * \param request The HTTP request including all HTTP info
      * \param resp Resultant HTTP QHttpResponse
@@ -77,10 +201,105 @@ private slots:
 
 private:
     
-    explicit QWebRouter(const QHash<QWebService::HttpMethod, RoutePairList> routes,
+    explicit QWebRouter(const QHash<QWebService::HttpMethod, RouteEntryList> routes,
                          const RouteFunction fourohfour,
+                         const QWebRouteIndex::Strategy strategy = QWebRouteIndex::LEVEL_TREE,
+                         const Settings &settings = Settings(),
                          QObject* parent = nullptr);
 
+    /**
+     * @brief QWebRouter Creates a router sharing the routing table of `other`,
+     * used to give every worker thread its own router.
+     */
+    explicit QWebRouter(const QWebRouter *other, QObject* parent = nullptr);
+
+    /**
+     * @brief respond Writes `webResp` now, or once it is finished if the
+     * handler deferred it.
+     */
+    void respond(const QSharedPointer<QWebRequest> &req,
+                 const QSharedPointer<QWebResponse> &webResp,
+                 QHttpResponse *resp);
+
+    /**
+     * @brief handleUnmatched Answers a request no route matched, with a 405
+     * if the path has a route for another method, otherwise with the 404
+     * handler.
+     */
+    void handleUnmatched(const QSharedPointer<QWebRequest> &req,
+                         const QSharedPointer<QWebResponse> &webResp,
+                         QHttpResponse *resp);
+
+    /**
+     * @brief waitForResponse Writes a deferred response once it is finished,
+     * or a 504 if the timeout passes first.
+     */
+    void waitForResponse(const QSharedPointer<QWebRequest> &req,
+                         const QSharedPointer<QWebResponse> &webResp,
+                         QHttpResponse *resp);
+
+    /**
+     * @brief cacheKey Key of the cached response for `request` to `entry`,
+     * empty if it is not cached.
+     */
+    QString cacheKey(const QHttpRequest *request, const RouteEntry *entry) const;
+
+    /**
+     * @brief writeCached Answers `request` from the cache
+     * @param started Time the request arrived, for the metrics
+     * @param extraHeaders Sent along, set by middleware before the lookup
+     * @return False if there is no fresh response for `key`
+     */
+    bool writeCached(const QString &key, const RouteEntry *entry,
+                     const QHttpRequest *request, QHttpResponse *resp,
+                     const qint64 started,
+                     const QHash<QString, QString> &extraHeaders = QHash<QString, QString>());
+
+    /**
+     * @brief cacheOnWrite Stores `webResp` under `key` once it is written,
+     * if it is successful and not private to its client. Only the headers
+     * describing the body are kept.
+     */
+    void cacheOnWrite(const QSharedPointer<QWebResponse> &webResp, const QString &key, const int ttl);
+
+    /**
+     * @brief record Counts a response to a route in this router's metrics
+     * shard and the access log, does nothing if both are off.
+     * @param request Request answered, read before it is deleted
+     * @param route Route that matched, null if none did
+     * @param metricsId Route from RouteEntry::metricsId
+     * @param started Time the request arrived on `m_clock`
+     */
+    inline
+    void record(const QHttpRequest *request, const QWebRoute *route, const int metricsId,
+                const qint64 started, const int status, const qint64 bytes) {
+        if (!m_shard && !m_settings.accessLog) {
+            return;
+        }
+
+        const qint64 latency = m_clock.nsecsElapsed() - started;
+
+        if (m_shard && metricsId >= 0) {
+            m_shard->record(metricsId, status, bytes, latency);
+        }
+
+        if (m_settings.accessLog) {
+            logAccess(request, route, latency, status, bytes);
+        }
+    }
+
+    //!< Queues a sampled access log record
+    void logAccess(const QHttpRequest *request, const QWebRoute *route,
+                   const qint64 latency, const int status, const qint64 bytes);
+
+    /**
+     * @brief writeResponse Writes `webResp` to `resp`, then counts it and
+     * finishes its trace once it was sent.
+     */
+    void writeResponse(const QSharedPointer<QWebRequest> &req,
+                       const QSharedPointer<QWebResponse> &webResp,
+                       QHttpResponse *resp);
+
     void setWebService(QWebService * const service) {
         if (!m_service && service) {
             m_service = service;
@@ -89,11 +308,47 @@ private:
         }
     }
 
-    const QHash<QWebService::HttpMethod, RoutePairList> m_routes;
+    /**
+     * @brief The MethodTable class holds the routes of a single method
+     */
+    class MethodTable {
+    public:
+
+        //!< Routes in registration order, contiguous
+        QVector<RouteEntry> entries;
+
+        //!< Index over `entries`, null if there are no routes
+        QWebRouteIndex::Ptr index;
+    };
+
+    //!< Routing table indexed by %QWebService::HttpMethod, built once on construction
+    MethodTable m_table[METHOD_COUNT];
 
     const RouteFunction m_404;
 
+    const Settings m_settings;
+
     const QWebService *m_service;
+
+    //!< Responses of routes with a cache TTL, null if Settings::cacheSize is 0.
+    //!< Not shared, every worker has its own.
+    QWebResponseCache *m_cache;
+
+    //!< Counters written by this router only, null if Settings::metrics is
+    //!< null. Owned by the metrics.
+    QWebMetrics::Shard *m_shard;
+
+    //!< Id counting requests no route matched
+    int m_unmatchedMetricsId;
+
+    //!< Responses seen by the access log, for sampling
+    quint64 m_logCount;
+
+    //!< Requests seen by the tracer, for sampling
+    quint64 m_traceCount;
+
+    //!< Started on construction, request latencies are measured against it
+    QElapsedTimer m_clock;
     
 };
 
@@ -0,0 +1,195 @@
+/*
+ * Copyright 2014 Kevin Brightwell <kevin.brightwell2@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef QWEBSTATICFILES_H
+#define QWEBSTATICFILES_H
+
+#include "../private/qtwebservicefwd.h"
+
+#include "QWebService.h"
+#include "QWebCompression.h"
+
+#include <QObject>
+#include <QByteArray>
+#include <QCache>
+#include <QDateTime>
+#include <QFileSystemWatcher>
+#include <QMultiHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+
+/**
+ * @brief The QWebStaticFiles class serves the files below a directory, see
+ * QWebServiceConfig::serveDirectory().
+ *
+ * Files up to MAX_CACHED_FILE_SIZE are kept in memory once read, the least
+ * recently used go first when the cache is full. A cached file is dropped
+ * when %QFileSystemWatcher reports a change, so hits need no file system
+ * access. With compression on, cached files also keep their `.gz` sibling
+ * or their compressed bodies, so hits never run zlib. The handler may be
+ * called from any thread.
+ */
+class QTWEBSERVICE_API QWebStaticFiles : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    //!< Larger files are streamed from disk on every request
+    static const qint64 MAX_CACHED_FILE_SIZE = 1024 * 1024;
+
+    /**
+     * @brief QWebStaticFiles
+     * @param prefix Path the files are served under, without a trailing `/`
+     * @param root Directory served
+     * @param cacheSize Bytes of file contents kept in memory
+     * @param parent QObject parent, file changes are handled on its thread
+     */
+    QWebStaticFiles(const QString &prefix, const QString &root, const qint64 cacheSize,
+                    QObject *parent = nullptr);
+
+    virtual
+    ~QWebStaticFiles();
+
+    /**
+     * @brief setCompression Sets the compression options of the service,
+     * before the first request. Drops every cached file.
+     */
+    void setCompression(const QWebCompression::Settings &settings);
+
+    /**
+     * @brief setNotFound Sets the handler of missing files and rejected
+     * paths, the service's 404 handler. Defaults to QWebRouter::DEFAULT_404.
+     */
+    void setNotFound(const QWebService::RouteFunction &func);
+
+    /**
+     * @brief handle Answers a `GET` for a file below the root, with the 404
+     * handler if there is none or the path leaves the root. Directories serve their
+     * `index.html`. A single byte range is honoured.
+     */
+    void handle(QSharedPointer<QWebRequest> req, QSharedPointer<QWebResponse> resp);
+
+    /**
+     * @brief normalize Turns the path of a request below the prefix into a
+     * path below the root. `.` and empty levels are dropped.
+     * @return Null if a level is `..` or the path holds a backslash or NUL
+     */
+    static QString normalize(const QString &path);
+
+    /**
+     * @brief parseRange Reads a `Range` header for a body of `size` bytes,
+     * only a single `bytes` range is supported.
+     * @return 1 with `offset` and `length` set, 0 if the header should be
+     *      ignored, -1 if the range can not be satisfied
+     */
+    static int parseRange(const QString &range, const qint64 size, qint64 *offset, qint64 *length);
+
+private slots:
+
+    //!< Watches `fileName` for the cache entry `key`, on our thread
+    void watch(const QString &fileName, const QString &key);
+
+    //!< Drops every cache entry of `fileName`
+    void fileChanged(const QString &fileName);
+
+private:
+
+    /**
+     * @brief The File class is a file found below the root
+     */
+    class File {
+    public:
+
+        File()
+            : size(0) {
+
+        }
+
+        QString fileName;
+
+        QString mimeType;
+
+        qint64 size;
+
+        QDateTime lastModified;
+
+        //!< Same tag QWebResponse::writeFile() uses
+        QString etag;
+
+        //!< Contents, null if the file is too large to keep
+        QByteArray data;
+
+        //!< Gzip body, the `.gz` sibling or compressed once, null if none
+        QByteArray gzip;
+
+        //!< Deflate body, compressed once, null if none
+        QByteArray deflate;
+
+        //!< Modification time of the `.gz` sibling, if `gzip` is from it
+        QDateTime gzipModified;
+
+        //!< Bytes kept in the cache
+        int cost() const {
+            return data.size() + gzip.size() + deflate.size();
+        }
+    };
+
+    //!< Looks `key` up in the cache, then on disk, caching what it read
+    bool find(const QString &key, File *out);
+
+    //!< Fills the encoded bodies of `file`, a cached file read from disk
+    void encode(File *file) const;
+
+    /**
+     * @brief writeCached Sends the body of a cached file in the encoding the
+     * client accepts, the response does not compress it again
+     */
+    void writeCached(const File &file, const QSharedPointer<QWebRequest> &req,
+                     const QSharedPointer<QWebResponse> &resp) const;
+
+    //!< Compression options of the service, see setCompression()
+    QWebCompression::Settings m_compression;
+
+    //!< Answers missing files, see setNotFound()
+    QWebService::RouteFunction m_404;
+
+    const QString m_prefix;
+
+    //!< Canonical path of the root, files must be below it
+    QString m_root;
+
+    //!< Guards `m_cache`, the handler runs on every worker thread
+    QMutex m_lock;
+
+    QCache<QString, File> m_cache;
+
+    //!< Only used on our own thread
+    QFileSystemWatcher m_watcher;
+
+    //!< Cache keys per watched file, a file may be reached by several paths
+    QMultiHash<QString, QString> m_watched;
+};
+
+#endif // QWEBSTATICFILES_H
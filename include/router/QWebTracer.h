@@ -0,0 +1,214 @@
+/*
+ * Copyright 2014 Kevin Brightwell <kevin.brightwell2@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+#ifndef QWEBTRACER_H
+#define QWEBTRACER_H
+
+#include "../private/qtwebservicefwd.h"
+
+#include <QAtomicInteger>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+#include <QWaitCondition>
+
+class QWebTracer_Writer;
+
+/**
+ * @brief The QWebTracer class writes the phases of sampled requests as Chrome
+ * trace events, see QWebServiceConfig::trace().
+ *
+ * The file is a JSON array of complete (`"ph": "X"`) events that
+ * `chrome://tracing` and Perfetto load, every request is its own row. Events
+ * are buffered and written by a background thread, in batches or at least
+ * every `flushInterval`. The array is closed when the tracer is deleted but
+ * loads without the closing bracket as well.
+ */
+class QTWEBSERVICE_API QWebTracer {
+
+public:
+
+    typedef QSharedPointer<QWebTracer> Ptr;
+
+    /**
+     * @brief The Settings class holds the options of the tracer, set through
+     * QWebServiceConfig::trace().
+     */
+    class Settings {
+    public:
+
+        Settings()
+            : sampleEvery(100),
+              flushInterval(100) {
+
+        }
+
+        //!< File written, tracing is off if empty
+        QString fileName;
+
+        //!< Traces one of every `sampleEvery` requests per worker, decided
+        //!< when the request arrives
+        int sampleEvery;
+
+        //!< Milliseconds between flushes
+        int flushInterval;
+    };
+
+    explicit QWebTracer(const Settings &settings);
+
+    /**
+     * Writes what is buffered and closes the array.
+     */
+    ~QWebTracer();
+
+    const Settings &settings() const {
+        return m_settings;
+    }
+
+    //!< Nanoseconds since the tracer was created, the clock of every trace
+    qint64 now() const {
+        return m_clock.nsecsElapsed();
+    }
+
+    /**
+     * @brief finish Queues the events of a finished request, safe from any
+     * thread
+     * @param status HTTP status sent
+     */
+    void finish(const QWebTrace &trace, const int status);
+
+    /**
+     * @brief events Formats `trace` as comma separated trace events, one
+     * spanning the request and one per phase
+     * @param id Row of the request
+     */
+    static QByteArray events(const QWebTrace &trace, const int status, const quint64 id);
+
+private:
+    /// @cond nodoc
+    friend class QWebTracer_Writer;
+    /// @endcond
+
+    Q_DISABLE_COPY(QWebTracer)
+
+    //!< Body of the writer thread
+    void run();
+
+    //!< Writes what is buffered, only called by the writer thread
+    void drain();
+
+    const Settings m_settings;
+
+    QElapsedTimer m_clock;
+
+    //!< Row of the next request
+    QAtomicInteger<quint64> m_nextId;
+
+    //!< Guards `m_buffer`, `m_empty` and `m_stopping`
+    QMutex m_lock;
+
+    //!< Events not written yet
+    QByteArray m_buffer;
+
+    //!< True until the first event, which comes without a separator
+    bool m_empty;
+
+    //!< Only written by the writer thread, so batches stay in order
+    QFile m_file;
+
+    //!< Wakes the writer early for a full batch or on shutdown
+    QWaitCondition m_wake;
+    bool m_stopping;
+
+    QWebTracer_Writer *m_writer;
+};
+
+/**
+ * @brief The QWebTrace class holds the phase timestamps of a single sampled
+ * request, on the clock of its QWebTracer.
+ */
+class QTWEBSERVICE_API QWebTrace {
+
+public:
+
+    /**
+     * Phases of a request, in order. The head was parsed by the time the
+     * router sees it, so ROUTE starts at the head and covers route matching.
+     */
+    enum Phase {
+        ROUTE,          //!< Matching the path, QWebRouter::findRoute
+        BODY,           //!< Receiving the request body
+        HANDLER,        //!< Middleware and handler
+        WAIT,           //!< From the handler returning to a deferred response finishing
+        SERIALIZE,      //!< Building the body, compression included
+        WRITE,          //!< Handing the response to the connection
+        PHASE_COUNT
+    };
+
+    explicit QWebTrace(const QWebTracer::Ptr &tracer);
+
+    qint64 now() const {
+        return m_tracer->now();
+    }
+
+    /**
+     * @brief mark Records `phase` from `begin` to `end`, as returned by now()
+     */
+    void mark(const Phase phase, const qint64 begin, const qint64 end) {
+        m_begin[phase] = begin;
+        m_end[phase] = end;
+    }
+
+    //!< Start of `phase`, -1 if it was not recorded
+    qint64 begin(const Phase phase) const {
+        return m_begin[phase];
+    }
+
+    //!< End of `phase`, -1 if it was not recorded
+    qint64 end(const Phase phase) const {
+        return m_end[phase];
+    }
+
+    //!< Name of `phase` in the trace
+    static const char *name(const Phase phase);
+
+    //!< %QWebService::HttpMethod of the request
+    int method;
+
+    //!< Route as registered, empty if none matched
+    QString route;
+
+    QString path;
+
+private:
+
+    const QWebTracer::Ptr m_tracer;
+
+    qint64 m_begin[PHASE_COUNT];
+    qint64 m_end[PHASE_COUNT];
+};
+
+#endif // QWEBTRACER_H
@@ -1,28 +1,67 @@
 #include "QWebService.h"
 
-QWebService::QWebService(QHttpServer *server, QWebRouter *router, QObject *parent) :
+#include "private/QWebWorker.h"
+
+#include <QTcpServer>
+
+QWebService::QWebService(QHttpServer *server, QWebRouter *router, const int workerCount,
+                         const bool reusePort, QObject *parent) :
     QObject(parent),
     m_server(server),
-    m_router(router)
+    m_router(router),
+    m_workers(workerCount > 0 ? new QWebWorkerPool(router, workerCount, reusePort, this) : nullptr),
+    m_running(false)
 {
 }
 
 QWebService::~QWebService() {
-    m_server->close();
+    if (m_server) {
+        m_server->close();
+    }
+
+    if (m_workers) {
+        m_workers->stop();
+    }
 }
 
 bool QWebService::startService(const QHostAddress &address, quint16 port) {
-    bool out = m_server->listen(address, port);
+    bool out = m_workers ? m_workers->start(address, port)
+                         : m_server->listen(address, port);
 
     if (out) { // it started successfully, emit the signal
-        qDebug() << "Started Web Service listening for:" << address << " on port" << port;
-        emit start(address, port);
+        m_running = true;
+        qDebug() << "Started Web Service listening for:" << address << " on port" << serverPort();
+        emit start(address, serverPort());
     }
 
     return out;
 }
 
 void QWebService::stopService() {
-    m_server->close();
-    emit stop();
+    if (m_server) {
+        m_server->close();
+    }
+
+    if (m_workers) {
+        m_workers->stop();
+    }
+
+    if (m_running) {
+        m_running = false;
+        emit stop();
+    }
+}
+
+quint16 QWebService::serverPort() const {
+    if (!m_running) {
+        return 0;
+    }
+
+    if (m_workers) {
+        return m_workers->port();
+    }
+
+    // QHttpServer does not expose its port, ask the socket it listens with
+    const QTcpServer *tcp = m_server->findChild<QTcpServer *>();
+    return tcp ? tcp->serverPort() : 0;
 }
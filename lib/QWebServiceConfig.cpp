@@ -1,19 +1,31 @@
 #include "QWebServiceConfig.h"
 
+#include "router/QWebMetrics.h"
+#include "router/QWebResponse.h"
 #include "router/QWebRoute.h"
 #include "router/QWebRouter.h"
+#include "router/QWebStaticFiles.h"
 
 #include <assert.h>
 
 QWebServiceConfig::QWebServiceConfig() :
     m_handlers(),
+    m_lastKey(),
+    m_middleware(),
     m_specialHandlers(),
     m_404(nullptr),
+    m_indexStrategy(QWebRouteIndex::LEVEL_TREE),
+    m_workerCount(0),
+    m_reusePort(false),
+    m_settings(),
+    m_metricsPath(),
+    m_accessLog(),
+    m_trace(),
     m_factory(new QWebRouteFactory()) {
 
     // initialize the handler QHash
 #define HANDLER_INIT( TYPE ) \
-    m_handlers[ QWebService::HttpMethod::TYPE ] = QSet<QWebServiceConfig::Key::Ptr>()
+    m_handlers[ QWebService::HttpMethod::TYPE ] = QList<QWebServiceConfig::Key::Ptr>()
 
     HANDLER_INIT(HTTP_GET);
     HANDLER_INIT(HTTP_DELETE);
@@ -30,15 +42,13 @@ QWebServiceConfig::~QWebServiceConfig() {
 
 QWebService* QWebServiceConfig::build(QObject* parent) const
 {
-    typedef QPair<QWebRoute::Ptr, QWebService::RouteFunction> RouteHandler;
-
-    QHash<QWebService::HttpMethod, QList<RouteHandler> > handlerTable;
+    QHash<QWebService::HttpMethod, QWebRouter::RouteEntryList> handlerTable;
 
     // keep a buffer of already used routes to use the same path to diff handler
     QHash<QString, QWebRoute::Ptr> routeBuff;
 
     for (const QWebService::HttpMethod method : m_handlers.keys()) {
-        QList<RouteHandler> handlers;
+        QWebRouter::RouteEntryList handlers;
 
         for (QWebServiceConfig::Key::Ptr route : m_handlers[method]) {
 //            if (route == "/") {
@@ -62,7 +72,17 @@ QWebService* QWebServiceConfig::build(QObject* parent) const
                 routeBuff[str] = routeObj;
             }
 
-            handlers += RouteHandler(routeObj, route->func);
+            QWebRouter::RouteEntry entry;
+            entry.route = routeObj;
+            entry.func = route->func;
+            entry.maxBodySize = route->maxBodySize;
+            entry.streamBody = route->streamBody;
+            entry.middleware = m_middleware + route->middleware;
+            entry.cacheTtl = route->cacheTtl;
+            entry.cacheKeys = route->cacheKeys;
+            entry.conditional = route->conditional;
+
+            handlers += entry;
         }
 
         // handlers now has all of the route objs
@@ -71,26 +91,64 @@ QWebService* QWebServiceConfig::build(QObject* parent) const
 
     // handlerTable is now populated minimizing QHttpRoute instances
 
+    QWebRouter::Settings settings = m_settings;
+
+    if (!m_metricsPath.isEmpty()) {
+        const QWebMetrics::Ptr metrics(new QWebMetrics);
+        settings.metrics = metrics;
+
+        QWebRouter::RouteEntry entry;
+        entry.route = routeBuff.contains(m_metricsPath) ? routeBuff[m_metricsPath]
+                                                       : m_factory->create(m_metricsPath);
+        entry.func = [metrics](QSharedPointer<QWebRequest>, QSharedPointer<QWebResponse> resp) {
+            resp->writeBytes(metrics->toPrometheus(), "text/plain; version=0.0.4");
+        };
+        entry.middleware = m_middleware;
+
+        handlerTable[QWebService::HttpMethod::HTTP_GET] += entry;
+    }
+
+    if (!m_accessLog.fileName.isEmpty()) {
+        settings.accessLog = QWebAccessLog::Ptr(new QWebAccessLog(m_accessLog));
+    }
+
+    if (!m_trace.fileName.isEmpty()) {
+        settings.tracer = QWebTracer::Ptr(new QWebTracer(m_trace));
+    }
+
     QWebService::RouteFunction fourohfour = this->m_404;
     if (!fourohfour) {
         fourohfour = QWebRouter::DEFAULT_404;
     }
 
     // we let the QHttpRouter ctor setup the parent relationships
-    auto router = new QWebRouter(handlerTable, fourohfour);
+    auto router = new QWebRouter(handlerTable, fourohfour, m_indexStrategy, settings);
 
-    auto server = new QHttpServer();
-    QObject::connect(server, &QHttpServer::newRequest, router, &QWebRouter::handleRoute );
+    // worker threads each get a copy of the router instead of sharing a server
+    QHttpServer *server = nullptr;
+    if (m_workerCount <= 0) {
+        server = new QHttpServer();
+        QObject::connect(server, &QHttpServer::newRequest, router, &QWebRouter::handleRoute );
+    }
 
-    auto service = new QWebService(server, router, parent);
+    auto service = new QWebService(server, router, m_workerCount, m_reusePort, parent);
     router->setWebService(service);
 
     router->setParent(service);
-    server->setParent(service);
+    if (server) {
+        server->setParent(service);
+    }
 
     // for all of the special handlers, set their parent to the new router
     for (auto ptr : this->m_specialHandlers) {
         ptr->setParent(router);
+
+        // static files encode what they cache ahead of time, and answer
+        // missing files like the rest of the service
+        if (QWebStaticFiles *files = qobject_cast<QWebStaticFiles *>(ptr)) {
+            files->setCompression(settings.compression);
+            files->setNotFound(fourohfour);
+        }
     }
 
     return service;
@@ -104,3 +162,180 @@ QWebServiceConfig& QWebServiceConfig::fourohfour(QWebService::RouteFunction func
 
     return *this;
 }
+
+QWebServiceConfig& QWebServiceConfig::routeIndexStrategy(const QWebRouteIndex::Strategy strategy)
+{
+    this->m_indexStrategy = strategy;
+
+    return *this;
+}
+
+QWebServiceConfig& QWebServiceConfig::workerCount(const int count)
+{
+    this->m_workerCount = count;
+
+    return *this;
+}
+
+QWebServiceConfig& QWebServiceConfig::reusePort(const bool enabled)
+{
+    this->m_reusePort = enabled;
+
+    return *this;
+}
+
+QWebServiceConfig& QWebServiceConfig::asyncTimeout(const int msec)
+{
+    this->m_settings.asyncTimeout = msec;
+
+    return *this;
+}
+
+QWebServiceConfig& QWebServiceConfig::jsonFormat(const QJsonDocument::JsonFormat format)
+{
+    this->m_settings.jsonFormat = format;
+
+    return *this;
+}
+
+QWebServiceConfig& QWebServiceConfig::maxBodySize(const qint64 bytes)
+{
+    if (m_lastKey) {
+        m_lastKey->maxBodySize = bytes;
+    } else {
+        qDebug() << "QWebServiceConfig::maxBodySize: No route was added yet";
+    }
+
+    return *this;
+}
+
+QWebServiceConfig& QWebServiceConfig::use(const QWebMiddleWare::Function &func)
+{
+    this->m_middleware += func;
+
+    return *this;
+}
+
+QWebServiceConfig& QWebServiceConfig::middleware(const QWebMiddleWare::Function &func)
+{
+    if (m_lastKey) {
+        m_lastKey->middleware += func;
+    } else {
+        qDebug() << "QWebServiceConfig::middleware: No route was added yet";
+    }
+
+    return *this;
+}
+
+QWebServiceConfig& QWebServiceConfig::streamBody(const bool enabled)
+{
+    if (m_lastKey) {
+        m_lastKey->streamBody = enabled;
+    } else {
+        qDebug() << "QWebServiceConfig::streamBody: No route was added yet";
+    }
+
+    return *this;
+}
+
+QWebServiceConfig& QWebServiceConfig::defaultMaxBodySize(const qint64 bytes)
+{
+    this->m_settings.maxBodySize = bytes;
+
+    return *this;
+}
+
+QWebServiceConfig& QWebServiceConfig::cache(const int ttl, const QStringList &queryKeys)
+{
+    if (m_lastKey) {
+        m_lastKey->cacheTtl = ttl;
+        m_lastKey->cacheKeys = queryKeys;
+    } else {
+        qDebug() << "QWebServiceConfig::cache: No route was added yet";
+    }
+
+    return *this;
+}
+
+QWebServiceConfig& QWebServiceConfig::responseCacheSize(const qint64 bytes)
+{
+    this->m_settings.cacheSize = bytes;
+
+    return *this;
+}
+
+QWebServiceConfig& QWebServiceConfig::compression(const int level, const qint64 minSize)
+{
+    this->m_settings.compression.level = level;
+    this->m_settings.compression.minSize = minSize;
+
+    return *this;
+}
+
+QWebServiceConfig& QWebServiceConfig::compressTypes(const QStringList &types)
+{
+    this->m_settings.compression.types = types;
+
+    return *this;
+}
+
+QWebServiceConfig& QWebServiceConfig::precompressed(const bool enabled)
+{
+    this->m_settings.compression.precompressed = enabled;
+
+    return *this;
+}
+
+QWebServiceConfig& QWebServiceConfig::conditional(const bool enabled)
+{
+    if (m_lastKey) {
+        m_lastKey->conditional = enabled;
+    } else {
+        qDebug() << "QWebServiceConfig::conditional: No route was added yet";
+    }
+
+    return *this;
+}
+
+QWebServiceConfig& QWebServiceConfig::metrics(const QString &path)
+{
+    this->m_metricsPath = path;
+
+    return *this;
+}
+
+QWebServiceConfig& QWebServiceConfig::accessLog(const QString &fileName, const QString &format,
+                                                const int sampleEvery)
+{
+    this->m_accessLog.fileName = fileName;
+    this->m_accessLog.format = format;
+    this->m_accessLog.sampleEvery = qMax(1, sampleEvery);
+
+    return *this;
+}
+
+QWebServiceConfig& QWebServiceConfig::trace(const QString &fileName, const int sampleEvery)
+{
+    this->m_trace.fileName = fileName;
+    this->m_trace.sampleEvery = qMax(1, sampleEvery);
+
+    return *this;
+}
+
+QWebServiceConfig& QWebServiceConfig::serveDirectory(const QString &prefix, const QString &root,
+                                                     const qint64 cacheSize)
+{
+    QString base = prefix;
+    while (base.endsWith('/')) {
+        base.chop(1);
+    }
+
+    // parented to the router on build() like other handler objects
+    QWebStaticFiles *files = new QWebStaticFiles(base, root, cacheSize);
+    m_specialHandlers += files;
+
+    // the path DSL stops at a single level, a regex takes every level below
+    const QRegularExpression pattern("^" + QRegularExpression::escape(base) + "(?:/.*)?$");
+
+    return get(pattern, files, &QWebStaticFiles::handle).conditional();
+}
@@ -0,0 +1,265 @@
+/*
+ * Copyright 2014 Kevin Brightwell <kevin.brightwell2@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "private/QWebWorker.h"
+
+#include "router/QWebRouter.h"
+
+#include <QDebug>
+#include <QMetaType>
+#include <QTcpSocket>
+
+#include <QHttpServer/qhttpconnection.h>
+
+#if defined(Q_OS_LINUX)
+#include <cerrno>
+#include <cstring>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/**
+ * Opens a listening socket on `address`:`port` with `SO_REUSEPORT` set.
+ * @return The descriptor, -1 on failure
+ */
+static
+int openReusePortSocket(const QHostAddress &address, const quint16 port) {
+    const QAbstractSocket::NetworkLayerProtocol protocol = address.protocol();
+    const bool ipv6 = protocol == QAbstractSocket::IPv6Protocol
+            || protocol == QAbstractSocket::AnyIPProtocol;
+
+    const int fd = ::socket(ipv6 ? AF_INET6 : AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    const int one = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0) {
+        ::close(fd);
+        return -1;
+    }
+
+    int result;
+    if (ipv6) {
+        // QHostAddress::Any accepts both IPv4 and IPv6
+        const int v6only = protocol == QAbstractSocket::IPv6Protocol ? 1 : 0;
+        ::setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &v6only, sizeof(v6only));
+
+        sockaddr_in6 addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin6_family = AF_INET6;
+        addr.sin6_port = htons(port);
+        if (protocol == QAbstractSocket::IPv6Protocol) {
+            const Q_IPV6ADDR ip = address.toIPv6Address();
+            std::memcpy(&addr.sin6_addr, &ip, sizeof(ip));
+            addr.sin6_scope_id = address.scopeId().toUInt();
+        } else {
+            addr.sin6_addr = in6addr_any;
+        }
+
+        result = ::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    } else {
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(address.toIPv4Address());
+
+        result = ::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    }
+
+    if (result < 0 || ::listen(fd, SOMAXCONN) < 0) {
+        ::close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+#endif
+
+QWebWorker::QWebWorker(QWebRouter *router, QObject *parent)
+    : QObject(parent),
+      m_router(router),
+      m_listener(nullptr) {
+
+    m_router->setParent(this);
+}
+
+QWebWorker::~QWebWorker() {
+    // connections, the listener and the router are children, they go with us
+}
+
+void QWebWorker::handleConnection(qintptr socketDescriptor) {
+    QTcpSocket *socket = new QTcpSocket;
+    if (!socket->setSocketDescriptor(socketDescriptor)) {
+        qDebug() << "QWebWorker: Could not take over socket:" << socket->errorString();
+        delete socket;
+        return;
+    }
+
+    serve(socket);
+}
+
+bool QWebWorker::listen(const QHostAddress &address, const quint16 port) {
+#if defined(Q_OS_LINUX)
+    if (m_listener) {
+        qDebug() << "QWebWorker: Already listening";
+        return false;
+    }
+
+    const int fd = openReusePortSocket(address, port);
+    if (fd < 0) {
+        qDebug() << "QWebWorker: Could not open SO_REUSEPORT socket:" << std::strerror(errno);
+        return false;
+    }
+
+    m_listener = new QTcpServer(this);
+    if (!m_listener->setSocketDescriptor(fd)) {
+        qDebug() << "QWebWorker: Could not listen:" << m_listener->errorString();
+        ::close(fd);
+        delete m_listener;
+        m_listener = nullptr;
+        return false;
+    }
+
+    connect(m_listener, &QTcpServer::newConnection, this, &QWebWorker::acceptPending);
+
+    return true;
+#else
+    Q_UNUSED(address);
+    Q_UNUSED(port);
+
+    qDebug() << "QWebWorker: SO_REUSEPORT listeners are only supported on Linux";
+    return false;
+#endif
+}
+
+void QWebWorker::acceptPending() {
+    while (m_listener->hasPendingConnections()) {
+        serve(m_listener->nextPendingConnection());
+    }
+}
+
+void QWebWorker::serve(QTcpSocket *socket) {
+    // the connection owns the socket and deletes itself on disconnect
+    QHttpConnection *connection = new QHttpConnection(socket, this);
+    connect(connection, &QHttpConnection::newRequest, m_router, &QWebRouter::handleRoute);
+}
+
+QWebWorkerPool::QWebWorkerPool(const QWebRouter *router, const int count,
+                               const bool reusePort, QObject *parent)
+    : QTcpServer(parent),
+      m_router(router),
+      m_count(qMax(1, count)),
+      m_reusePort(reusePort),
+      m_threads(),
+      m_workers(),
+      m_next(0) {
+
+    qRegisterMetaType<qintptr>("qintptr");
+    qRegisterMetaType<QHostAddress>("QHostAddress");
+}
+
+QWebWorkerPool::~QWebWorkerPool() {
+    stop();
+}
+
+bool QWebWorkerPool::start(const QHostAddress &address, const quint16 port) {
+    if (!m_threads.isEmpty()) {
+        qDebug() << "QWebWorkerPool: Already started";
+        return false;
+    }
+
+    for (int i = 0; i < m_count; ++i) {
+        QThread *thread = new QThread(this);
+        thread->setObjectName(QString("QWebWorker-%1").arg(i));
+
+        // the routing table is immutable, every worker shares its routes
+        QWebWorker *worker = new QWebWorker(new QWebRouter(m_router));
+        worker->moveToThread(thread);
+        connect(thread, &QThread::finished, worker, &QObject::deleteLater);
+
+        m_threads += thread;
+        m_workers += worker;
+
+        thread->start();
+    }
+
+    if (m_reusePort) {
+        // every worker binds the same address, the kernel balances accepts;
+        // the first one resolves a port of 0 so the others share its port
+        quint16 bound = port;
+        for (QWebWorker *worker : m_workers) {
+            bool ok = false;
+            QMetaObject::invokeMethod(worker, "listen", Qt::BlockingQueuedConnection,
+                                      Q_RETURN_ARG(bool, ok),
+                                      Q_ARG(QHostAddress, address), Q_ARG(quint16, bound));
+            if (!ok) {
+                stop();
+                return false;
+            }
+
+            bound = worker->port();
+        }
+
+        return true;
+    }
+
+    if (!listen(address, port)) {
+        stop();
+        return false;
+    }
+
+    return true;
+}
+
+void QWebWorkerPool::stop() {
+    close();
+
+    for (QThread *thread : m_threads) {
+        thread->quit();
+        thread->wait();
+        delete thread;
+    }
+
+    m_threads.clear();
+    m_workers.clear();
+    m_next = 0;
+}
+
+quint16 QWebWorkerPool::port() const {
+    if (m_reusePort) {
+        return m_workers.isEmpty() ? 0 : m_workers.first()->port();
+    }
+
+    return serverPort();
+}
+
+void QWebWorkerPool::incomingConnection(qintptr socketDescriptor) {
+    QWebWorker *worker = m_workers[m_next];
+    m_next = (m_next + 1) % m_workers.size();
+
+    QMetaObject::invokeMethod(worker, "handleConnection", Qt::QueuedConnection,
+                              Q_ARG(qintptr, socketDescriptor));
+}
@@ -0,0 +1,268 @@
+/*
+ * Copyright 2014 Kevin Brightwell <kevin.brightwell2@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "router/QWebAccessLog.h"
+
+#include "router/QWebJsonWriter.h"
+#include "router/QWebRouter.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QMutexLocker>
+#include <QThread>
+
+const QString QWebAccessLog::DEFAULT_FORMAT = "%t %a %m %r %U %s %b %D";
+
+const QString QWebAccessLog::JSON_FORMAT = "json";
+
+//!< Bytes formatted before they are written out
+static const int BATCH_SIZE = 64 * 1024;
+
+/**
+ * Runs QWebAccessLog::run(), only QWebAccessLog starts it.
+ */
+class QWebAccessLog_Writer : public QThread {
+
+public:
+
+    explicit QWebAccessLog_Writer(QWebAccessLog *log)
+        : m_log(log) {
+
+    }
+
+protected:
+
+    virtual
+    void run() {
+        m_log->run();
+    }
+
+private:
+
+    QWebAccessLog * const m_log;
+};
+
+/**
+ * Smallest power of two of at least `capacity`, and at least 2.
+ */
+static
+quint64 ringSize(const int capacity) {
+    quint64 size = 2;
+    while (size < quint64(qMax(2, capacity))) {
+        size <<= 1;
+    }
+
+    return size;
+}
+
+QWebAccessLog::QWebAccessLog(const Settings &settings)
+    : m_settings(settings),
+      m_needsPath(settings.format == JSON_FORMAT || settings.format.contains("%U")),
+      m_slots(new Slot[ringSize(settings.capacity)]),
+      m_mask(ringSize(settings.capacity) - 1),
+      m_head(0),
+      m_tail(0),
+      m_dropped(0),
+      m_file(settings.fileName),
+      m_lock(),
+      m_wake(),
+      m_stopping(false),
+      m_writer(nullptr) {
+
+    // a slot is free for the producer at position `sequence`
+    for (quint64 i = 0; i <= m_mask; ++i) {
+        m_slots[i].sequence.store(i);
+    }
+
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "QWebAccessLog: Could not open" << settings.fileName << ":" << m_file.errorString();
+    }
+
+    m_writer = new QWebAccessLog_Writer(this);
+    m_writer->start(QThread::LowPriority);
+}
+
+QWebAccessLog::~QWebAccessLog() {
+    {
+        QMutexLocker locker(&m_lock);
+        m_stopping = true;
+        m_wake.wakeAll();
+    }
+
+    m_writer->wait();
+    delete m_writer;
+
+    delete[] m_slots;
+}
+
+bool QWebAccessLog::append(const Record &record) {
+    quint64 pos = m_head.load();
+    Slot *slot = nullptr;
+
+    // claim the slot at `pos` unless another producer was first
+    for (;;) {
+        slot = &m_slots[pos & m_mask];
+
+        const qint64 diff = qint64(slot->sequence.loadAcquire() - pos);
+        if (diff == 0) {
+            if (m_head.testAndSetRelaxed(pos, pos + 1)) {
+                break;
+            }
+
+            pos = m_head.load();
+        } else if (diff < 0) {
+            // the writer has not freed it yet, the ring is full
+            m_dropped.fetchAndAddRelaxed(1);
+            return false;
+        } else {
+            pos = m_head.load();
+        }
+    }
+
+    slot->record = record;
+    slot->sequence.storeRelease(pos + 1);
+
+    return true;
+}
+
+void QWebAccessLog::run() {
+    QMutexLocker locker(&m_lock);
+
+    while (!m_stopping) {
+        locker.unlock();
+        drain();
+        locker.relock();
+
+        if (!m_stopping) {
+            m_wake.wait(&m_lock, m_settings.flushInterval);
+        }
+    }
+
+    locker.unlock();
+
+    // everything appended before the log was deleted
+    drain();
+}
+
+void QWebAccessLog::drain() {
+    QByteArray batch;
+
+    for (;;) {
+        Slot &slot = m_slots[m_tail & m_mask];
+        if (slot.sequence.loadAcquire() != m_tail + 1) {
+            break;
+        }
+
+        // the strings are released before the slot is handed back
+        Record record;
+        qSwap(record, slot.record);
+        slot.sequence.storeRelease(m_tail + m_mask + 1);
+        ++m_tail;
+
+        batch += format(m_settings.format, record);
+        batch += '\n';
+
+        if (batch.size() >= BATCH_SIZE) {
+            m_file.write(batch);
+            batch.clear();
+        }
+    }
+
+    if (!batch.isEmpty()) {
+        m_file.write(batch);
+    }
+
+    m_file.flush();
+}
+
+/**
+ * Percent-encodes spaces and control characters, so a value taken from the
+ * request can neither split a field nor start a new line.
+ */
+static
+QString escapeField(const QString &value) {
+    QString out;
+    for (const QChar c : value) {
+        if (c.unicode() > 0x20 && c.unicode() != 0x7f) {
+            out += c;
+        } else {
+            out += QString("%%1").arg(c.unicode(), 2, 16, QChar('0')).toUpper();
+        }
+    }
+
+    return out;
+}
+
+QByteArray QWebAccessLog::format(const QString &format, const Record &record) {
+    const QString time = QDateTime::fromMSecsSinceEpoch(record.time).toUTC()
+            .toString("yyyy-MM-ddThh:mm:ss.zzzZ");
+    const QString method = QWebRouter::methodName(static_cast<QWebService::HttpMethod>(record.method));
+
+    if (format == JSON_FORMAT) {
+        QWebJsonWriter json;
+        json.beginObject()
+            .field("time", time)
+            .field("peer", record.peer)
+            .field("method", method)
+            .field("route", record.route)
+            .field("path", record.path)
+            .field("status", record.status)
+            .field("bytes", record.bytes)
+            .field("latencyUs", record.latency / 1000)
+            .endObject();
+
+        return json.data();
+    }
+
+    QString line;
+    line.reserve(format.size() + 64);
+
+    // empty values are written as `-` so every line has the same fields
+    const auto orDash = [](const QString &value) {
+        return value.isEmpty() ? QString("-") : value;
+    };
+
+    for (int i = 0; i < format.size(); ++i) {
+        if (format[i] != '%' || i + 1 == format.size()) {
+            line += format[i];
+            continue;
+        }
+
+        switch (format[++i].unicode()) {
+        case 't': line += time; break;
+        case 'a': line += orDash(record.peer); break;
+        case 'm': line += orDash(method); break;
+        case 'r': line += orDash(record.route); break;
+        case 'U': line += orDash(escapeField(record.path)); break;
+        case 's': line += QString::number(record.status); break;
+        case 'b': line += QString::number(record.bytes); break;
+        case 'D': line += QString::number(record.latency / 1000); break;
+        case '%': line += '%'; break;
+        default:
+            line += '%';
+            line += format[i];
+            break;
+        }
+    }
+
+    return line.toUtf8();
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2014 Kevin Brightwell <kevin.brightwell2@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "router/QWebCompression.h"
+
+#include <cstring>
+
+#include <zlib.h>
+
+QStringList QWebCompression::defaultTypes() {
+    return QStringList()
+            << "text/"
+            << "application/json"
+            << "application/javascript"
+            << "application/xml"
+            << "image/svg+xml";
+}
+
+QWebCompression::Encoding QWebCompression::negotiate(const QString &acceptEncoding) {
+    if (acceptEncoding.isEmpty()) {
+        return IDENTITY;
+    }
+
+    // -1 while a coding is not listed, an explicit entry wins over `*`
+    // wherever it is (RFC 7231 5.3.4)
+    double gzip = -1;
+    double deflate = -1;
+    double any = -1;
+
+    for (const QString &part : acceptEncoding.split(',')) {
+        const QStringList params = part.split(';');
+        const QString coding = params.first().trimmed().toLower();
+
+        double quality = 1;
+        for (int i = 1; i < params.size(); ++i) {
+            // `q=0.5` as well as `q = 0.5`
+            const int eq = params[i].indexOf('=');
+            if (eq >= 0 && params[i].left(eq).trimmed().compare("q", Qt::CaseInsensitive) == 0) {
+                quality = params[i].mid(eq + 1).trimmed().toDouble();
+            }
+        }
+
+        if (coding == "gzip" || coding == "x-gzip") {
+            gzip = qMax(gzip, quality);
+        } else if (coding == "deflate") {
+            deflate = qMax(deflate, quality);
+        } else if (coding == "*") {
+            any = qMax(any, quality);
+        }
+    }
+
+    if (gzip < 0) {
+        gzip = any;
+    }
+
+    if (deflate < 0) {
+        deflate = any;
+    }
+
+    // q=0 means "not acceptable", gzip wins a tie
+    if (gzip > 0 && gzip >= deflate) {
+        return GZIP;
+    }
+
+    return deflate > 0 ? DEFLATE : IDENTITY;
+}
+
+bool QWebCompression::isCompressible(const QString &contentType, const QStringList &types) {
+    const int params = contentType.indexOf(';');
+    const QString type = contentType.left(params).trimmed();
+
+    for (const QString &candidate : types) {
+        if (candidate.endsWith('/')) {
+            if (type.startsWith(candidate, Qt::CaseInsensitive)) {
+                return true;
+            }
+        } else if (type.compare(candidate, Qt::CaseInsensitive) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+QByteArray QWebCompression::compress(const QByteArray &data, const Encoding encoding, const int level) {
+    if (encoding == IDENTITY) {
+        return QByteArray();
+    }
+
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+
+    // adding 16 to the window bits makes zlib write a gzip wrapper, without
+    // it zlib writes its own, which is what HTTP calls "deflate"
+    const int windowBits = encoding == GZIP ? 15 + 16 : 15;
+    if (deflateInit2(&stream, level, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return QByteArray();
+    }
+
+    QByteArray out;
+    out.resize(int(deflateBound(&stream, uLong(data.size()))));
+
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.constData()));
+    stream.avail_in = uInt(data.size());
+    stream.next_out = reinterpret_cast<Bytef *>(out.data());
+    stream.avail_out = uInt(out.size());
+
+    // the output is large enough for a single call
+    const int result = deflate(&stream, Z_FINISH);
+    deflateEnd(&stream);
+
+    if (result != Z_STREAM_END) {
+        return QByteArray();
+    }
+
+    out.resize(int(stream.total_out));
+
+    return out;
+}
+
+QString QWebCompression::name(const Encoding encoding) {
+    switch (encoding) {
+    case GZIP: return "gzip";
+    case DEFLATE: return "deflate";
+    default: return QString();
+    }
+}
+
+void QWebCompression::addVary(QHash<QString, QString> *headers) {
+    const QString vary = headers->value("Vary");
+
+    if (vary.isEmpty()) {
+        headers->insert("Vary", "Accept-Encoding");
+    } else if (!vary.contains("Accept-Encoding", Qt::CaseInsensitive) && vary.trimmed() != "*") {
+        headers->insert("Vary", vary + ", Accept-Encoding");
+    }
+}
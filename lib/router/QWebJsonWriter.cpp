@@ -0,0 +1,245 @@
+/*
+ * Copyright 2014 Kevin Brightwell <kevin.brightwell2@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "router/QWebJsonWriter.h"
+
+#include <QLocale>
+
+#include <cmath>
+
+QWebJsonWriter::QWebJsonWriter(const int reserve)
+    : m_out(),
+      m_first(),
+      m_afterKey(false) {
+
+    m_out.reserve(reserve);
+}
+
+void QWebJsonWriter::separate() {
+    if (m_afterKey) {
+        m_afterKey = false;
+        return;
+    }
+
+    if (!m_first.isEmpty()) {
+        if (m_first.last()) {
+            m_first.last() = false;
+        } else {
+            m_out.append(',');
+        }
+    }
+}
+
+void QWebJsonWriter::openContainer(const char open) {
+    separate();
+    m_out.append(open);
+    m_first.append(true);
+}
+
+void QWebJsonWriter::closeContainer(const char close) {
+    m_out.append(close);
+    if (!m_first.isEmpty()) {
+        m_first.removeLast();
+    }
+}
+
+QWebJsonWriter &QWebJsonWriter::beginObject() {
+    openContainer('{');
+    return *this;
+}
+
+QWebJsonWriter &QWebJsonWriter::endObject() {
+    closeContainer('}');
+    return *this;
+}
+
+QWebJsonWriter &QWebJsonWriter::beginArray() {
+    openContainer('[');
+    return *this;
+}
+
+QWebJsonWriter &QWebJsonWriter::endArray() {
+    closeContainer(']');
+    return *this;
+}
+
+QWebJsonWriter &QWebJsonWriter::key(const QString &name) {
+    separate();
+    writeString(name.constData(), name.length());
+    m_out.append(':');
+    m_afterKey = true;
+
+    return *this;
+}
+
+QWebJsonWriter &QWebJsonWriter::key(const char *name) {
+    return key(QString::fromUtf8(name));
+}
+
+QWebJsonWriter &QWebJsonWriter::value(const QString &str) {
+    separate();
+    writeString(str.constData(), str.length());
+
+    return *this;
+}
+
+QWebJsonWriter &QWebJsonWriter::value(const char *str) {
+    return value(QString::fromUtf8(str));
+}
+
+QWebJsonWriter &QWebJsonWriter::value(const bool b) {
+    separate();
+    m_out.append(b ? "true" : "false");
+
+    return *this;
+}
+
+QWebJsonWriter &QWebJsonWriter::value(const int i) {
+    return value(qint64(i));
+}
+
+QWebJsonWriter &QWebJsonWriter::value(const long i) {
+    return value(qint64(i));
+}
+
+QWebJsonWriter &QWebJsonWriter::value(const qint64 i) {
+    separate();
+    writeInteger(i < 0 ? 0 - quint64(i) : quint64(i), i < 0);
+
+    return *this;
+}
+
+QWebJsonWriter &QWebJsonWriter::value(const uint i) {
+    return value(quint64(i));
+}
+
+QWebJsonWriter &QWebJsonWriter::value(const ulong i) {
+    return value(quint64(i));
+}
+
+QWebJsonWriter &QWebJsonWriter::value(const quint64 i) {
+    separate();
+    writeInteger(i, false);
+
+    return *this;
+}
+
+QWebJsonWriter &QWebJsonWriter::value(const double d) {
+    if (!std::isfinite(d)) {
+        return nullValue();
+    }
+
+    separate();
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 7, 0)
+    // the shortest form that reads back as `d`, like QJsonDocument writes it
+    m_out.append(QByteArray::number(d, 'g', QLocale::FloatingPointShortest));
+#else
+    // 17 digits always read back, fewer are tried first to keep 0.1 short
+    QByteArray number;
+    for (int precision = 15; precision <= 17; ++precision) {
+        number = QByteArray::number(d, 'g', precision);
+        if (number.toDouble() == d) {
+            break;
+        }
+    }
+
+    m_out.append(number);
+#endif
+
+    return *this;
+}
+
+QWebJsonWriter &QWebJsonWriter::nullValue() {
+    separate();
+    m_out.append("null");
+
+    return *this;
+}
+
+void QWebJsonWriter::writeInteger(const quint64 magnitude, const bool negative) {
+    // enough for any 64 bit value and its sign, written backwards
+    char buff[24];
+    char *end = buff + sizeof(buff);
+    char *p = end;
+
+    quint64 n = magnitude;
+    do {
+        *--p = char('0' + n % 10);
+        n /= 10;
+    } while (n);
+
+    if (negative) {
+        *--p = '-';
+    }
+
+    m_out.append(p, int(end - p));
+}
+
+void QWebJsonWriter::writeString(const QChar *str, const int length) {
+    static const char hex[] = "0123456789abcdef";
+
+    m_out.append('"');
+
+    for (int i = 0; i < length; ++i) {
+        const ushort c = str[i].unicode();
+
+        if (c < 0x80) {
+            switch (c) {
+            case '"':  m_out.append("\\\""); break;
+            case '\\': m_out.append("\\\\"); break;
+            case '\b': m_out.append("\\b"); break;
+            case '\f': m_out.append("\\f"); break;
+            case '\n': m_out.append("\\n"); break;
+            case '\r': m_out.append("\\r"); break;
+            case '\t': m_out.append("\\t"); break;
+            default:
+                if (c < 0x20) {
+                    const char escaped[] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf] };
+                    m_out.append(escaped, sizeof(escaped));
+                } else {
+                    m_out.append(char(c));
+                }
+            }
+        } else if (c < 0x800) {
+            m_out.append(char(0xc0 | (c >> 6)));
+            m_out.append(char(0x80 | (c & 0x3f)));
+        } else if (QChar::isHighSurrogate(c) && i + 1 < length && str[i + 1].isLowSurrogate()) {
+            const uint ucs4 = QChar::surrogateToUcs4(c, str[++i].unicode());
+            m_out.append(char(0xf0 | (ucs4 >> 18)));
+            m_out.append(char(0x80 | ((ucs4 >> 12) & 0x3f)));
+            m_out.append(char(0x80 | ((ucs4 >> 6) & 0x3f)));
+            m_out.append(char(0x80 | (ucs4 & 0x3f)));
+        } else if (QChar::isSurrogate(c)) {
+            // a lone surrogate is not valid UTF-8, keep it as an escape
+            const char escaped[] = { '\\', 'u', hex[c >> 12], hex[(c >> 8) & 0xf],
+                                     hex[(c >> 4) & 0xf], hex[c & 0xf] };
+            m_out.append(escaped, sizeof(escaped));
+        } else {
+            m_out.append(char(0xe0 | (c >> 12)));
+            m_out.append(char(0x80 | ((c >> 6) & 0x3f)));
+            m_out.append(char(0x80 | (c & 0x3f)));
+        }
+    }
+
+    m_out.append('"');
+}
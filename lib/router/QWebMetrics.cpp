@@ -0,0 +1,259 @@
+/*
+ * Copyright 2014 Kevin Brightwell <kevin.brightwell2@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "router/QWebMetrics.h"
+
+#include <QMutexLocker>
+
+#include <algorithm>
+
+//!< Bucket limits of the exported histogram, in microseconds
+static const quint64 EXPORT_LIMITS[] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000,
+    100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000
+};
+
+static const int EXPORT_LIMIT_COUNT = sizeof(EXPORT_LIMITS) / sizeof(EXPORT_LIMITS[0]);
+
+//!< Status codes counted apart, sorted; a 404 is told from a 413 and a 304
+//!< from a 200, anything else is counted as `other`
+static const int STATUS_CODES[] = {
+    100, 101, 102,
+    200, 201, 202, 203, 204, 205, 206, 207,
+    300, 301, 302, 303, 304, 305, 307,
+    400, 401, 402, 403, 404, 405, 406, 407, 408, 409, 410, 411, 412, 413, 414, 415, 416, 417,
+    422, 423, 424, 425, 426,
+    500, 501, 502, 503, 504, 505, 506, 507, 509, 510
+};
+
+static_assert(sizeof(STATUS_CODES) / sizeof(STATUS_CODES[0]) == QWebMetrics::STATUS_CODE_COUNT,
+              "STATUS_CODE_COUNT must match STATUS_CODES");
+
+/**
+ * Adds `value` to a counter only this thread writes, a plain load and store
+ * instead of a locked add.
+ */
+static inline
+void add(QAtomicInteger<quint64> &counter, const quint64 value) {
+    counter.store(counter.load() + value);
+}
+
+/**
+ * Escapes a Prometheus label value.
+ */
+static
+QString escapeLabel(QString value) {
+    return value.replace('\\', "\\\\").replace('"', "\\\"").replace('\n', "\\n");
+}
+
+QWebMetrics::Counters::Counters() {
+
+}
+
+QWebMetrics::Shard::Shard(const int routeCount)
+    : m_routeCount(routeCount),
+      m_routes(new QAtomicPointer<Counters>[routeCount]) {
+
+}
+
+QWebMetrics::Shard::~Shard() {
+    for (int i = 0; i < m_routeCount; ++i) {
+        delete m_routes[i].load();
+    }
+
+    delete[] m_routes;
+}
+
+void QWebMetrics::Shard::record(const int route, const int status, const qint64 bytes, const qint64 latency) {
+    if (route < 0 || route >= m_routeCount) {
+        return;
+    }
+
+    Counters *counters = m_routes[route].load();
+    if (!counters) {
+        counters = new Counters;
+
+        // readers only see it once it is complete
+        m_routes[route].storeRelease(counters);
+    }
+
+    add(counters->responses[statusIndex(status)], 1);
+    add(counters->bytes, quint64(qMax<qint64>(0, bytes)));
+    add(counters->latencySum, quint64(qMax<qint64>(0, latency)));
+    add(counters->buckets[bucketOf(quint64(qMax<qint64>(0, latency)) / 1000)], 1);
+}
+
+QWebMetrics::QWebMetrics()
+    : m_routes(),
+      m_lock(),
+      m_shards() {
+
+}
+
+QWebMetrics::~QWebMetrics() {
+    qDeleteAll(m_shards);
+}
+
+int QWebMetrics::addRoute(const QString &method, const QString &route) {
+    Route info;
+    info.method = method;
+    info.route = route;
+
+    m_routes += info;
+
+    return m_routes.size() - 1;
+}
+
+QWebMetrics::Shard *QWebMetrics::addShard() {
+    QMutexLocker locker(&m_lock);
+
+    Shard *shard = new Shard(m_routes.size());
+    m_shards += shard;
+
+    return shard;
+}
+
+int QWebMetrics::bucketOf(const quint64 usec) {
+    if (usec < quint64(SUB_BUCKETS)) {
+        return int(usec);
+    }
+
+    int octave = 0;
+#if defined(__GNUC__)
+    octave = 63 - __builtin_clzll(usec);
+#else
+    for (quint64 v = usec; v > 1; v >>= 1) {
+        ++octave;
+    }
+#endif
+
+    // SUB_BUCKETS is 4, the two bits after the leading one
+    const int sub = int((usec >> (octave - 2)) & 3);
+    const int bucket = SUB_BUCKETS + (octave - 2) * SUB_BUCKETS + sub;
+
+    return qMin(bucket, BUCKET_COUNT - 1);
+}
+
+quint64 QWebMetrics::bucketLimit(const int bucket) {
+    if (bucket >= BUCKET_COUNT - 1) {
+        return 0;
+    }
+
+    if (bucket < SUB_BUCKETS) {
+        return quint64(bucket + 1);
+    }
+
+    const int octave = (bucket - SUB_BUCKETS) / SUB_BUCKETS + 2;
+    const int sub = (bucket - SUB_BUCKETS) % SUB_BUCKETS;
+
+    return quint64(SUB_BUCKETS + sub + 1) << (octave - 2);
+}
+
+int QWebMetrics::statusIndex(const int status) {
+    const int *end = STATUS_CODES + STATUS_CODE_COUNT;
+    const int *it = std::lower_bound(STATUS_CODES, end, status);
+
+    return it != end && *it == status ? int(it - STATUS_CODES) : STATUS_CODE_COUNT;
+}
+
+QByteArray QWebMetrics::toPrometheus() const {
+    QMutexLocker locker(&m_lock);
+
+    QString requests =
+            "# HELP qwebservice_responses_total Responses sent, by route and status code.\n"
+            "# TYPE qwebservice_responses_total counter\n";
+    QString bytes =
+            "# HELP qwebservice_response_bytes_total Body bytes sent, by route.\n"
+            "# TYPE qwebservice_response_bytes_total counter\n";
+    QString latency =
+            "# HELP qwebservice_request_duration_seconds Time from the request head to the response.\n"
+            "# TYPE qwebservice_request_duration_seconds histogram\n";
+
+    for (int r = 0; r < m_routes.size(); ++r) {
+        quint64 responses[STATUS_CODE_COUNT + 1] = { 0 };
+        quint64 byteCount = 0;
+        quint64 latencySum = 0;
+        quint64 buckets[BUCKET_COUNT] = { 0 };
+        bool seen = false;
+
+        for (const Shard *shard : m_shards) {
+            if (r >= shard->m_routeCount) {
+                continue;
+            }
+
+            const Counters *counters = shard->m_routes[r].loadAcquire();
+            if (!counters) {
+                continue;
+            }
+
+            seen = true;
+            for (int i = 0; i <= STATUS_CODE_COUNT; ++i) {
+                responses[i] += counters->responses[i].load();
+            }
+            byteCount += counters->bytes.load();
+            latencySum += counters->latencySum.load();
+            for (int i = 0; i < BUCKET_COUNT; ++i) {
+                buckets[i] += counters->buckets[i].load();
+            }
+        }
+
+        if (!seen) {
+            continue;
+        }
+
+        const QString labels = QString("method=\"%1\",route=\"%2\"")
+                .arg(escapeLabel(m_routes[r].method), escapeLabel(m_routes[r].route));
+
+        quint64 total = 0;
+        for (int i = 0; i <= STATUS_CODE_COUNT; ++i) {
+            total += responses[i];
+            if (responses[i] > 0) {
+                const QString code = i < STATUS_CODE_COUNT ? QString::number(STATUS_CODES[i]) : QString("other");
+                requests += QString("qwebservice_responses_total{%1,code=\"%2\"} %3\n")
+                        .arg(labels, code).arg(responses[i]);
+            }
+        }
+
+        bytes += QString("qwebservice_response_bytes_total{%1} %2\n").arg(labels).arg(byteCount);
+
+        // a bucket counts towards the first limit its upper bound fits in
+        quint64 cumulative = 0;
+        int bucket = 0;
+        for (int l = 0; l < EXPORT_LIMIT_COUNT; ++l) {
+            while (bucket < BUCKET_COUNT - 1 && bucketLimit(bucket) <= EXPORT_LIMITS[l]) {
+                cumulative += buckets[bucket++];
+            }
+
+            latency += QString("qwebservice_request_duration_seconds_bucket{%1,le=\"%2\"} %3\n")
+                    .arg(labels).arg(EXPORT_LIMITS[l] / 1e6).arg(cumulative);
+        }
+
+        latency += QString("qwebservice_request_duration_seconds_bucket{%1,le=\"+Inf\"} %2\n")
+                .arg(labels).arg(total);
+        latency += QString("qwebservice_request_duration_seconds_sum{%1} %2\n")
+                .arg(labels).arg(latencySum / 1e9, 0, 'f', 9);
+        latency += QString("qwebservice_request_duration_seconds_count{%1} %2\n")
+                .arg(labels).arg(total);
+    }
+
+    return (requests + bytes + latency).toUtf8();
+}
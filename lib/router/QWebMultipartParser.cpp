@@ -0,0 +1,241 @@
+/*
+ * Copyright 2014 Kevin Brightwell <kevin.brightwell2@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "router/QWebMultipartParser.h"
+
+#include <QList>
+
+#include <cstring>
+
+/**
+ * Finds `needle` in `[data, data + size)`, memchr skips to each candidate
+ * first byte so most of the content is only looked at once.
+ * @return Offset of the match, -1 if there is none. A partial match at the
+ *      end of the data is not reported.
+ */
+static
+int findBytes(const char *data, const int size, const QByteArray &needle) {
+    const char first = needle.at(0);
+    const int needleSize = needle.size();
+
+    const char *p = data;
+    const char * const end = data + size;
+
+    while (end - p >= needleSize) {
+        p = static_cast<const char *>(std::memchr(p, first, (end - p) - needleSize + 1));
+        if (!p) {
+            return -1;
+        }
+
+        if (std::memcmp(p, needle.constData(), needleSize) == 0) {
+            return int(p - data);
+        }
+
+        ++p;
+    }
+
+    return -1;
+}
+
+/**
+ * Value of parameter `key` of a header like `form-data; name="a"`, unquoted.
+ */
+static
+QByteArray headerParam(const QByteArray &header, const QByteArray &key) {
+    for (const QByteArray &param : header.split(';')) {
+        const int eq = param.indexOf('=');
+        if (eq < 0 || param.left(eq).trimmed().toLower() != key) {
+            continue;
+        }
+
+        QByteArray value = param.mid(eq + 1).trimmed();
+        if (value.size() >= 2 && value.startsWith('"') && value.endsWith('"')) {
+            value = value.mid(1, value.size() - 2);
+        }
+
+        return value;
+    }
+
+    return QByteArray();
+}
+
+QWebMultipartParser::QWebMultipartParser(const QByteArray &boundary, QObject *parent)
+    : QObject(parent),
+      m_delimiter("\r\n--" + boundary),
+      // the first boundary may start the body, without a line break before it
+      m_buffer("\r\n"),
+      m_state(PREAMBLE) {
+
+}
+
+QWebMultipartParser::~QWebMultipartParser() {
+
+}
+
+QByteArray QWebMultipartParser::boundaryFrom(const QByteArray &contentType) {
+    if (!contentType.trimmed().toLower().startsWith("multipart/")) {
+        return QByteArray();
+    }
+
+    return headerParam(contentType, "boundary");
+}
+
+void QWebMultipartParser::feed(const QByteArray &data) {
+    if (m_state == DONE || m_state == FAILED) {
+        return;
+    }
+
+    m_buffer.append(data);
+
+    const int consumed = parse();
+    m_buffer.remove(0, consumed);
+}
+
+void QWebMultipartParser::end() {
+    if (m_state != DONE && m_state != FAILED) {
+        fail("Body ended before the closing boundary");
+    }
+}
+
+void QWebMultipartParser::fail(const QString &message) {
+    m_state = FAILED;
+    m_buffer.clear();
+
+    emit error(message);
+}
+
+int QWebMultipartParser::parse() {
+    const char * const data = m_buffer.constData();
+    const int size = m_buffer.size();
+
+    int pos = 0;
+
+    while (true) {
+        switch (m_state) {
+        case PREAMBLE:
+        case CONTENT: {
+            const int found = findBytes(data + pos, size - pos, m_delimiter);
+
+            if (found < 0) {
+                // keep what could be the start of a delimiter for next time
+                const int safe = qMax(0, size - pos - (m_delimiter.size() - 1));
+                if (m_state == CONTENT && safe > 0) {
+                    emit partData(QByteArray(data + pos, safe));
+                }
+
+                return pos + safe;
+            }
+
+            if (m_state == CONTENT) {
+                if (found > 0) {
+                    emit partData(QByteArray(data + pos, found));
+                }
+
+                emit partEnd();
+            }
+
+            pos += found + m_delimiter.size();
+            m_state = AFTER_BOUNDARY;
+            break;
+        }
+
+        case AFTER_BOUNDARY: {
+            // transport padding is allowed before the line break
+            while (pos < size && (data[pos] == ' ' || data[pos] == '\t')) {
+                ++pos;
+            }
+
+            if (size - pos < 2) {
+                return pos;
+            }
+
+            if (data[pos] == '-' && data[pos + 1] == '-') {
+                // the epilogue is ignored
+                m_state = DONE;
+                emit finished();
+                return size;
+            }
+
+            if (data[pos] != '\r' || data[pos + 1] != '\n') {
+                fail("Malformed boundary");
+                return size;
+            }
+
+            pos += 2;
+            m_state = HEADERS;
+            break;
+        }
+
+        case HEADERS: {
+            Part part;
+
+            if (size - pos >= 2 && data[pos] == '\r' && data[pos + 1] == '\n') {
+                // a part without headers
+                pos += 2;
+            } else {
+                const int found = findBytes(data + pos, size - pos, "\r\n\r\n");
+
+                if (found < 0) {
+                    if (size - pos > MAX_HEADER_SIZE) {
+                        fail("Part headers are too large");
+                        return size;
+                    }
+
+                    return pos;
+                }
+
+                parseHeaders(data + pos, found, &part);
+                pos += found + 4;
+            }
+
+            m_state = CONTENT;
+            emit partBegin(part);
+            break;
+        }
+
+        case DONE:
+        case FAILED:
+            return size;
+        }
+    }
+}
+
+void QWebMultipartParser::parseHeaders(const char *data, const int size, Part *part) {
+    const QList<QByteArray> lines = QByteArray::fromRawData(data, size).split('\n');
+
+    for (const QByteArray &line : lines) {
+        const int colon = line.indexOf(':');
+        if (colon <= 0) {
+            continue;
+        }
+
+        const QByteArray name = line.left(colon).trimmed().toLower();
+        const QByteArray value = line.mid(colon + 1).trimmed();
+
+        part->headers.insert(name, value);
+    }
+
+    const QByteArray disposition = part->headers.value("content-disposition");
+    part->name = QString::fromUtf8(headerParam(disposition, "name"));
+    part->fileName = QString::fromUtf8(headerParam(disposition, "filename"));
+    part->contentType = part->headers.value("content-type");
+}
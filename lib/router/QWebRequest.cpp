@@ -1,5 +1,9 @@
 #include "router/QWebRequest.h"
 
+#include "router/QWebMultipartParser.h"
+
+#include <cstring>
+
 
 QWebRequest::QWebRequest(QHttpRequest *httpReq,
                          const QHash<QString, QString> &postParams,
@@ -8,9 +12,45 @@ QWebRequest::QWebRequest(QHttpRequest *httpReq,
                          QObject *parent) :
     QObject(parent),
     m_req(httpReq),
+    m_match(),
+    m_matchParsed(true),
     m_urlParams(urlParams),
-    m_postParams(postParams),
-    m_splat(splat)
+    m_splat(splat),
+    m_queryParsed(true),
+    m_queryParams(postParams),
+    m_body(httpReq ? httpReq->body() : QByteArray()),
+    m_bodySize(m_body.size()),
+    m_bodyRejected(false),
+    m_bodyStreamed(false),
+    m_multipart(nullptr),
+    m_metricsId(-1),
+    m_started(0),
+    m_route(nullptr),
+    m_trace()
+{
+
+}
+
+QWebRequest::QWebRequest(QHttpRequest *httpReq,
+                         const QWebRoute::Match &match,
+                         QObject *parent) :
+    QObject(parent),
+    m_req(httpReq),
+    m_match(match),
+    m_matchParsed(false),
+    m_urlParams(),
+    m_splat(),
+    m_queryParsed(false),
+    m_queryParams(),
+    m_body(),
+    m_bodySize(0),
+    m_bodyRejected(false),
+    m_bodyStreamed(false),
+    m_multipart(nullptr),
+    m_metricsId(-1),
+    m_started(0),
+    m_route(nullptr),
+    m_trace()
 {
 
 }
@@ -32,3 +72,129 @@ QSharedPointer<QWebRequest> QWebRequest::create(QHttpRequest *httpReq,
 
     return QSharedPointer<QWebRequest>(ptr);
 }
+
+QSharedPointer<QWebRequest> QWebRequest::create(QHttpRequest *httpReq,
+                                                const QWebRoute::Match &match,
+                                                QObject *parent) {
+    QWebRequest *ptr = new QWebRequest(httpReq, match, parent);
+
+    if (parent != nullptr) {
+        return QSharedPointer<QWebRequest>(ptr, &QObject::deleteLater);
+    }
+
+    return QSharedPointer<QWebRequest>(ptr);
+}
+
+/**
+ * Value of a hex digit, -1 if `c` is not one.
+ */
+static inline
+int hexValue(const char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+
+    return -1;
+}
+
+/**
+ * Decodes `[begin, end)` into `buff` and returns it as UTF-8, `buff` is
+ * reused between calls to avoid allocating.
+ */
+static
+QString decodeComponent(const char *begin, const char *end, QByteArray &buff) {
+    buff.resize(0);
+
+    for (const char *p = begin; p < end; ++p) {
+        if (*p == '+') {
+            buff.append(' ');
+        } else if (*p == '%' && end - p > 2 && hexValue(p[1]) >= 0 && hexValue(p[2]) >= 0) {
+            buff.append(char(hexValue(p[1]) << 4 | hexValue(p[2])));
+            p += 2;
+        } else {
+            // malformed escapes are kept as they are
+            buff.append(*p);
+        }
+    }
+
+    return QString::fromUtf8(buff.constData(), buff.size());
+}
+
+void QWebRequest::parseQuery(const QByteArray &query, QHash<QString, QString> *out) {
+    QByteArray buff;
+    buff.reserve(query.size());
+
+    const char *p = query.constData();
+    const char * const end = p + query.size();
+
+    while (p < end) {
+        const char *pairEnd = static_cast<const char *>(std::memchr(p, '&', end - p));
+        if (!pairEnd) {
+            pairEnd = end;
+        }
+
+        if (pairEnd != p) {
+            const char *eq = static_cast<const char *>(std::memchr(p, '=', pairEnd - p));
+            const char *keyEnd = eq ? eq : pairEnd;
+
+            const QString key = decodeComponent(p, keyEnd, buff);
+            const QString value = eq ? decodeComponent(eq + 1, pairEnd, buff) : QString("");
+
+            out->insertMulti(key, value);
+        }
+
+        // one past `end` is as far as a pointer may go
+        if (pairEnd == end) {
+            break;
+        }
+
+        p = pairEnd + 1;
+    }
+}
+
+void QWebRequest::parseQueryParams() {
+    m_queryParsed = true;
+
+    if (m_req->url().hasQuery()) {
+        parseQuery(m_req->url().query(QUrl::FullyEncoded).toLatin1(), &m_queryParams);
+    }
+
+    const QHttpRequest::HttpMethod method = m_req->method();
+    if (method == QHttpRequest::HTTP_POST || method == QHttpRequest::HTTP_PUT) {
+        const QString contentType = m_req->headers().value("content-type");
+
+        if (contentType.isEmpty() || contentType.startsWith("application/x-www-form-urlencoded")) {
+            parseQuery(m_body, &m_queryParams);
+        }
+    }
+}
+
+QWebMultipartParser *QWebRequest::multipart() {
+    if (m_multipart) {
+        return m_multipart;
+    }
+
+    // requests built without a QHttpRequest have no headers to read
+    if (!m_req) {
+        return nullptr;
+    }
+
+    const QByteArray boundary = QWebMultipartParser::boundaryFrom(
+                m_req->headers().value("content-type").toLatin1());
+    if (boundary.isEmpty()) {
+        return nullptr;
+    }
+
+    m_multipart = new QWebMultipartParser(boundary, this);
+
+    if (m_bodyStreamed) {
+        connect(this, &QWebRequest::bodyData, m_multipart, &QWebMultipartParser::feed);
+        connect(this, &QWebRequest::bodyEnd, m_multipart, &QWebMultipartParser::end);
+    }
+
+    return m_multipart;
+}
@@ -22,14 +22,287 @@
 
 #include "router/QWebResponse.h"
 
+#include "router/QWebJsonWriter.h"
+#include "router/QWebRequest.h"
+#include "router/QWebTracer.h"
+
 #include <QPair>
 #include <QFile>
 #include <QFileInfo>
 #include <QIODevice>
+#include <QDateTime>
+#include <QLocale>
 #include <QDebug>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQueue>
+
+#include <QHttpServer/qhttprequest.h>
+
+//!< Format of HTTP dates, RFC 7231 IMF-fixdate, always GMT
+static const QString HTTP_DATE_FORMAT = "ddd, dd MMM yyyy hh:mm:ss 'GMT'";
+
+static
+QString httpDate(const QDateTime &time) {
+    return QLocale::c().toString(time.toUTC(), HTTP_DATE_FORMAT);
+}
+
+static
+QDateTime parseHttpDate(const QString &date) {
+    QDateTime time = QLocale::c().toDateTime(date.trimmed(), HTTP_DATE_FORMAT);
+    time.setTimeSpec(Qt::UTC);
+
+    return time;
+}
+
+/**
+ * 64 bit FNV-1a of `data`, cheap and stable across processes unlike qHash().
+ */
+static
+quint64 fnv1a(const QByteArray &data) {
+    quint64 hash = Q_UINT64_C(14695981039346656037);
+
+    const uchar *it = reinterpret_cast<const uchar *>(data.constData());
+    const uchar *end = it + data.size();
+    for (; it != end; ++it) {
+        hash ^= *it;
+        hash *= Q_UINT64_C(1099511628211);
+    }
+
+    return hash;
+}
+
+/**
+ * @brief The QWebResponse_Queue class holds the chunks pushed with
+ * QWebResponse::write() until the stream sends them, it is shared by the
+ * response and the stream.
+ */
+class QWebResponse_Queue : public QObject {
+    Q_OBJECT
+
+public:
+
+    //!< What the stream gets from take()
+    enum Next {
+        CHUNK,      //!< A chunk to send
+        WAIT,       //!< Nothing queued yet, the stream is woken by the next push
+        DONE        //!< Ended and everything was sent
+    };
+
+    explicit QWebResponse_Queue(const int capacity)
+        : QObject(),
+          m_lock(),
+          m_chunks(),
+          m_capacity(qMax(1, capacity)),
+          m_ended(false),
+          m_closed(false),
+          m_blocked(false),
+          m_stream(nullptr) {
+
+    }
+
+    //!< Queues `chunk` unless the queue is full, ended or closed
+    bool push(const QByteArray &chunk) {
+        QMutexLocker locker(&m_lock);
+
+        if (m_ended || m_closed) {
+            return false;
+        }
+
+        if (m_chunks.size() >= m_capacity) {
+            m_blocked = true;
+            return false;
+        }
+
+        // an empty chunk would end the chunked encoding
+        if (!chunk.isEmpty()) {
+            m_chunks.enqueue(chunk);
+            wake();
+        }
+
+        return true;
+    }
+
+    //!< No chunk is queued after this, the stream ends once it is drained
+    void end() {
+        QMutexLocker locker(&m_lock);
+
+        if (!m_ended) {
+            m_ended = true;
+            wake();
+        }
+    }
+
+    //!< Called by the stream for its next chunk, on its thread
+    Next take(QByteArray *chunk) {
+        bool resume = false;
+        {
+            QMutexLocker locker(&m_lock);
+
+            if (m_chunks.isEmpty()) {
+                return m_ended ? DONE : WAIT;
+            }
+
+            *chunk = m_chunks.dequeue();
+
+            resume = m_blocked;
+            m_blocked = false;
+        }
+
+        // outside the lock, a receiver may push straight away
+        if (resume) {
+            emit writable();
+        }
+
+        return CHUNK;
+    }
+
+    //!< Sets the stream woken by push() and end(), null once it is gone
+    void attach(QObject *stream) {
+        QMutexLocker locker(&m_lock);
+
+        m_stream = stream;
+        if (!stream) {
+            // the client went away, nothing is sent anymore
+            m_closed = true;
+            m_chunks.clear();
+        }
+    }
+
+signals:
+
+    //!< A chunk that push() refused fits again
+    void writable();
+
+private:
+
+    //!< Asks the stream for its next chunk, on its own thread; `m_lock` is
+    //!< held so the stream cannot be deleted meanwhile
+    void wake() {
+        if (m_stream) {
+            QMetaObject::invokeMethod(m_stream, "next", Qt::QueuedConnection);
+        }
+    }
+
+    QMutex m_lock;
+
+    QQueue<QByteArray> m_chunks;
+
+    const int m_capacity;
+
+    bool m_ended;
+
+    bool m_closed;
+
+    //!< True if push() refused a chunk since the last take()
+    bool m_blocked;
+
+    QObject *m_stream;
+};
+
+/**
+ * @brief The QWebResponse_Stream class writes a streamed response one chunk
+ * at a time, the next chunk is only taken once the socket has written
+ * everything before it. Chunks come from a %QWebResponse::ChunkSource, or are
+ * pushed to a %QWebResponse_Queue.
+ */
+class QWebResponse_Stream : public QObject {
+    Q_OBJECT
+
+public:
+
+    QWebResponse_Stream(const QWebResponse::ChunkSource &source, QHttpResponse *response)
+        : QObject(response),
+          m_source(source),
+          m_queue(),
+          m_response(response),
+          m_writing(false),
+          m_done(false) {
+
+        connect(response, &QHttpResponse::allBytesWritten, this, &QWebResponse_Stream::drained);
+    }
+
+    QWebResponse_Stream(const QSharedPointer<QWebResponse_Queue> &queue, QHttpResponse *response)
+        : QObject(response),
+          m_source(nullptr),
+          m_queue(queue),
+          m_response(response),
+          m_writing(false),
+          m_done(false) {
+
+        connect(response, &QHttpResponse::allBytesWritten, this, &QWebResponse_Stream::drained);
+        m_queue->attach(this);
+    }
+
+    virtual
+    ~QWebResponse_Stream() {
+        if (m_queue) {
+            m_queue->attach(nullptr);
+        }
+    }
+
+public slots:
+
+    void next() {
+        if (m_done || m_writing) {
+            return;
+        }
+
+        QByteArray chunk;
+        if (m_queue) {
+            if (m_queue->take(&chunk) == QWebResponse_Queue::WAIT) {
+                return;
+            }
+        } else {
+            chunk = m_source();
+        }
+
+        if (chunk.isEmpty()) {
+            m_done = true;
+
+            // release the source, the response may delete us once ended
+            m_source = nullptr;
+            m_response->end();
+            return;
+        }
+
+        m_writing = true;
+        m_response->write(chunk);
+    }
+
+private slots:
+
+    void drained() {
+        m_writing = false;
+        next();
+    }
+
+private:
+
+    QWebResponse::ChunkSource m_source;
+
+    QSharedPointer<QWebResponse_Queue> m_queue;
+
+    QHttpResponse * const m_response;
+
+    //!< True until the socket wrote the last chunk
+    bool m_writing;
+
+    bool m_done;
+};
 
 QWebResponse::QWebResponse()
-    : m_outFunc(nullptr), m_status(StatusCode::STATUS_OK)
+    : m_outFunc(nullptr), m_streamFunc(nullptr), m_queue(), m_status(StatusCode::STATUS_OK),
+      m_jsonFormat(QJsonDocument::Compact),
+      m_deferred(false), m_finished(0), m_written(false),
+      m_onWritten(nullptr),
+      m_compression(nullptr),
+      m_encoding(QWebCompression::IDENTITY),
+      m_conditional(false),
+      m_httpRequest(nullptr),
+      m_sentStatus(0),
+      m_sentBytes(0),
+      m_trace()
 {
 
 }
@@ -55,40 +328,190 @@ void QWebResponse::setStatusCode(StatusCode code) {
 }
 
 bool QWebResponse::isValidResponse() {
-    return (bool)m_outFunc;
+    return (bool)m_outFunc || (bool)m_streamFunc;
 }
 
-bool QWebResponse::writeFile(QFile file) {
-    const QFileInfo info(file);
+void QWebResponse::defer() {
+    m_deferred = true;
+}
+
+bool QWebResponse::isDeferred() const {
+    return m_deferred;
+}
+
+void QWebResponse::finish() {
+    if (m_finished.testAndSetOrdered(0, 1)) {
+        emit finished();
+    }
+}
+
+bool QWebResponse::isFinished() const {
+    return m_finished.load() != 0;
+}
 
-    m_outFunc = [info](ResponseError *error) -> QByteArray {
+bool QWebResponse::expire() {
+    return m_finished.testAndSetOrdered(0, 1);
+}
+
+bool QWebResponse::writeFile(const QString &fileName, const QString contentType) {
+    return writeFile(fileName, contentType, 0, -1);
+}
+
+bool QWebResponse::writeFile(const QString &fileName, const QString contentType,
+                             const qint64 offset, const qint64 length) {
+    m_outFunc = nullptr;
+    m_queue.clear();
+    // the encoding is only known when writing, it is read then
+    m_streamFunc = [this, fileName, offset, length](ResponseError *error, qint64 *outLength) -> ChunkSource {
         // check if the file exists
+        const QFileInfo info(fileName);
         if (!info.exists()) {
             *error = FILE_DOES_NOT_EXIST;
-            return QByteArray();
+            return nullptr;
+        }
+
+        QString path = fileName;
+
+        // a range is of the file as it is
+        const bool ranged = offset > 0 || length >= 0;
+
+        if (m_compression && m_compression->precompressed && !ranged
+                && !m_headers.contains("Content-Encoding")) {
+            const QFileInfo gzipped(fileName + ".gz");
+
+            if (gzipped.isFile()) {
+                QWebCompression::addVary(&m_headers);
+
+                if (m_encoding == QWebCompression::GZIP) {
+                    path = gzipped.filePath();
+                    m_headers["Content-Encoding"] = "gzip";
+                }
+            }
+        }
+
+        // validators come from the file system, the file is not opened if
+        // the client has it already
+        if (m_conditional && m_status == StatusCode::STATUS_OK && !m_headers.contains("ETag")) {
+            m_headers["ETag"] = QString("\"%1-%2\"").arg(info.size(), 0, 16)
+                    .arg(info.lastModified().toMSecsSinceEpoch(), 0, 16);
+        }
+
+        // every encoding is its own representation with its own tag, also
+        // if the handler set it
+        if (path != fileName && m_headers.contains("ETag")) {
+            QString &etag = m_headers["ETag"];
+            if (etag.endsWith('"')) {
+                etag.insert(etag.size() - 1, "-gzip");
+            }
+        }
+
+        // error pages sent from a file are never answered with a 304
+        if (m_conditional && m_status == StatusCode::STATUS_OK) {
+            if (!m_headers.contains("Last-Modified")) {
+                setLastModified(info.lastModified());
+            }
+
+            if (isNotModified(m_httpRequest, m_headers)) {
+                const qint64 available = qMax<qint64>(0, QFileInfo(path).size() - offset);
+
+                *error = SUCCESS;
+                *outLength = length >= 0 ? qMin(length, available) : available;
+                return nullptr;
+            }
         }
 
-        QFile file(info.path());
+        QSharedPointer<QFile> file(new QFile(path));
 
         // open it for reading
-        if (!file.open(QIODevice::ReadOnly)) {
+        if (!file->open(QIODevice::ReadOnly)) {
+            *error = FILE_COULD_NOT_OPEN;
+
+            return nullptr;
+        }
+
+        if (offset > 0 && !file->seek(offset)) {
             *error = FILE_COULD_NOT_OPEN;
 
-            return QByteArray();
+            return nullptr;
         }
 
-        // read the file!
+        const qint64 available = qMax<qint64>(0, file->size() - offset);
+        QSharedPointer<qint64> remaining(new qint64(length >= 0 ? qMin(length, available) : available));
+
         *error = SUCCESS;
-        QByteArray out = file.readAll();
-        file.close();
+        *outLength = *remaining;
 
-        return out;
+        // the file is closed with the last reference, when the stream is done
+        return [file, remaining]() -> QByteArray {
+            const QByteArray chunk = file->read(qMin(*remaining, qint64(STREAM_CHUNK_SIZE)));
+            *remaining -= chunk.size();
+
+            return chunk;
+        };
     };
 
+    if (!m_headers.contains("Content-Type")) {
+        m_headers["Content-Type"] = contentType;
+    }
+
     return true;
 }
 
+bool QWebResponse::writeStream(const ChunkSource &source, const QString contentType) {
+    m_outFunc = nullptr;
+    m_queue.clear();
+    m_streamFunc = [source](ResponseError *error, qint64 *length) -> ChunkSource {
+        // no Content-Length, QHttpResponse falls back to chunked encoding
+        *error = SUCCESS;
+        *length = -1;
+
+        return source;
+    };
+
+    if (!m_headers.contains("Content-Type")) {
+        m_headers["Content-Type"] = contentType;
+    }
+
+    return true;
+}
+
+bool QWebResponse::beginStream(const QString contentType, const int queueSize) {
+    m_outFunc = nullptr;
+    m_queue = QSharedPointer<QWebResponse_Queue>(new QWebResponse_Queue(queueSize));
+    connect(m_queue.data(), &QWebResponse_Queue::writable, this, &QWebResponse::writable);
+
+    m_streamFunc = [](ResponseError *error, qint64 *length) -> ChunkSource {
+        *error = SUCCESS;
+        *length = -1;
+
+        // never called, the stream takes its chunks from `m_queue`
+        return []() { return QByteArray(); };
+    };
+
+    if (!m_headers.contains("Content-Type")) {
+        m_headers["Content-Type"] = contentType;
+    }
+
+    return true;
+}
+
+bool QWebResponse::write(const QByteArray &chunk) {
+    const QSharedPointer<QWebResponse_Queue> queue = m_queue;
+
+    return queue && queue->push(chunk);
+}
+
+void QWebResponse::end() {
+    const QSharedPointer<QWebResponse_Queue> queue = m_queue;
+
+    if (queue) {
+        queue->end();
+    }
+}
+
 bool QWebResponse::writeText(const QString text, const QString contentType) {
+    m_streamFunc = nullptr;
+    m_queue.clear();
 
     m_outFunc = [text](ResponseError *error) -> QByteArray {
         QByteArray out;
@@ -105,11 +528,47 @@ bool QWebResponse::writeText(const QString text, const QString contentType) {
     return true;
 }
 
+bool QWebResponse::writeBytes(const QByteArray &data, const QString contentType) {
+    m_streamFunc = nullptr;
+    m_queue.clear();
+
+    m_outFunc = [data](ResponseError *error) -> QByteArray {
+        Q_UNUSED(error);
+
+        return data;
+    };
+
+    if (!m_headers.contains("Content-Type")) {
+        m_headers["Content-Type"] = contentType;
+    }
+
+    return true;
+}
+
 bool QWebResponse::writeJson(const QJsonDocument doc) {
-    m_outFunc = [doc](ResponseError *error) -> QByteArray {
+    m_streamFunc = nullptr;
+    m_queue.clear();
+    // the format is read when writing, it may be changed after this
+    m_outFunc = [this, doc](ResponseError *error) -> QByteArray {
+        Q_UNUSED(error);
+
+        return doc.toJson(m_jsonFormat);
+    };
+
+    m_headers["Content-Type"] = "application/json";
+
+    return true;
+}
+
+bool QWebResponse::writeJson(const QWebJsonWriter &writer) {
+    m_streamFunc = nullptr;
+    m_queue.clear();
+
+    const QByteArray json = writer.data();
+    m_outFunc = [json](ResponseError *error) -> QByteArray {
         Q_UNUSED(error);
 
-        return doc.toJson(QJsonDocument::Indented);
+        return json;
     };
 
     m_headers["Content-Type"] = "application/json";
@@ -117,32 +576,271 @@ bool QWebResponse::writeJson(const QJsonDocument doc) {
     return true;
 }
 
+void QWebResponse::setJsonFormat(const QJsonDocument::JsonFormat format) {
+    m_jsonFormat = format;
+}
+
+void QWebResponse::setETag(const QString &tag) {
+    if (tag.startsWith('"') || tag.startsWith("W/")) {
+        m_headers["ETag"] = tag;
+    } else {
+        m_headers["ETag"] = '"' + tag + '"';
+    }
+}
+
+void QWebResponse::setLastModified(const QDateTime &time) {
+    m_headers["Last-Modified"] = httpDate(time);
+}
+
+bool QWebResponse::isNotModified(const QHttpRequest *request, const QHash<QString, QString> &headers) {
+    if (!request || (request->method() != QHttpRequest::HTTP_GET
+                     && request->method() != QHttpRequest::HTTP_HEAD)) {
+        return false;
+    }
+
+    // If-None-Match wins, If-Modified-Since is ignored if it is there
+    const QString ifNoneMatch = request->headers().value("if-none-match");
+    if (!ifNoneMatch.isEmpty()) {
+        QString etag = headers.value("ETag");
+        if (etag.isEmpty()) {
+            return false;
+        }
+
+        if (ifNoneMatch.trimmed() == "*") {
+            return true;
+        }
+
+        // If-None-Match compares weakly
+        if (etag.startsWith("W/")) {
+            etag = etag.mid(2);
+        }
+
+        for (QString tag : ifNoneMatch.split(',')) {
+            tag = tag.trimmed();
+            if (tag.startsWith("W/")) {
+                tag = tag.mid(2);
+            }
+
+            if (tag == etag) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    const QString ifModifiedSince = request->headers().value("if-modified-since");
+    const QString lastModified = headers.value("Last-Modified");
+    if (ifModifiedSince.isEmpty() || lastModified.isEmpty()) {
+        return false;
+    }
+
+    const QDateTime since = parseHttpDate(ifModifiedSince);
+    const QDateTime modified = parseHttpDate(lastModified);
+
+    return since.isValid() && modified.isValid() && modified <= since;
+}
+
+void QWebResponse::writeNotModified(QHttpResponse *httpResponse, const QHash<QString, QString> &headers,
+                                    const qint64 length) {
+    // the headers of the full response, apart from those describing its body
+    for (auto it = headers.constBegin(); it != headers.constEnd(); ++it) {
+        if (it.key().compare("Content-Type", Qt::CaseInsensitive) != 0
+                && it.key().compare("Content-Encoding", Qt::CaseInsensitive) != 0) {
+            httpResponse->setHeader(it.key(), it.value());
+        }
+    }
+
+    // a 304 has no body, its length is the one of the representation it
+    // validates (RFC 7230 3.3.2) and keeps QHttpResponse from chunking
+    httpResponse->setHeader("Content-Length", QString::number(qMax<qint64>(0, length)));
+
+    httpResponse->writeHead(QHttpResponse::STATUS_NOT_MODIFIED);
+    httpResponse->end();
+}
+
 QWebResponse::ResponseError QWebResponse::writeToResponse(QSharedPointer<QWebRequest> req,
                                                           QHttpResponse *httpResponse) {
+    if (m_written) {
+        return ALREADY_WRITTEN;
+    }
+
     if (!isValidResponse()) {
         return NO_DATA_SET;
     }
 
+    m_httpRequest = req ? req->httpRequest() : nullptr;
+
+    m_encoding = QWebCompression::IDENTITY;
+    if (m_compression && m_httpRequest) {
+        m_encoding = QWebCompression::negotiate(m_httpRequest->headers().value("accept-encoding"));
+    }
+
     ResponseError error = SUCCESS;
+
+    QWebTrace * const trace = m_trace.data();
+    const qint64 serializeStart = trace ? trace->now() : 0;
+
+    if (m_streamFunc) {
+        qint64 length = -1;
+        const ChunkSource source = m_streamFunc(&error, &length);
+
+        if (error != SUCCESS) {
+            return error;
+        }
+
+        const qint64 writeStart = trace ? trace->now() : 0;
+        if (trace) {
+            trace->mark(QWebTrace::SERIALIZE, serializeStart, writeStart);
+        }
+
+        m_written = true;
+
+        // only a file the client already has comes without a source
+        if (!source) {
+            m_sentStatus = QHttpResponse::STATUS_NOT_MODIFIED;
+            writeNotModified(httpResponse, m_headers, length);
+
+            if (trace) {
+                trace->mark(QWebTrace::WRITE, writeStart, trace->now());
+            }
+            return SUCCESS;
+        }
+
+        m_sentStatus = m_status;
+        m_sentBytes = qMax<qint64>(0, length);
+
+        if (length >= 0) {
+            httpResponse->setHeader("Content-Length", QString::number(length));
+        }
+
+        for (QString key : m_headers.keys()) {
+            httpResponse->setHeader(key, m_headers[key]);
+        }
+
+        httpResponse->writeHead(m_status);
+
+        // owned by the response, the stream goes with it if the client leaves
+        QWebResponse_Stream *stream = m_queue ? new QWebResponse_Stream(m_queue, httpResponse)
+                                              : new QWebResponse_Stream(source, httpResponse);
+        stream->next();
+
+        // only the first chunk, the rest follows as the socket drains
+        if (trace) {
+            trace->mark(QWebTrace::WRITE, writeStart, trace->now());
+        }
+
+        return SUCCESS;
+    }
+
     QByteArray buff = m_outFunc(&error);
 
     if (error != SUCCESS) {
         return error;
     }
 
+    m_written = true;
+
     QSharedPointer<QByteArray> outPtr;
     emit responseDataPrepared(req, buff, outPtr);
 
     const QByteArray &out = outPtr ? *outPtr : buff;
 
-    httpResponse->setHeader("Content-Length", QString::number(buff.length()));
-    for (QString key : m_headers.keys()) {
-        httpResponse->setHeader(key, m_headers[key]);
+    QHash<QString, QString> headers = m_headers;
+    QByteArray compressed;
+
+    // partial content is of the identity encoding
+    const bool compressible = m_compression && m_compression->level > 0 && !out.isEmpty()
+            && m_status == StatusCode::STATUS_OK
+            && out.size() >= m_compression->minSize
+            && !headers.contains("Content-Encoding")
+            && QWebCompression::isCompressible(headers.value("Content-Type"), m_compression->types);
+
+    if (m_conditional && m_status == StatusCode::STATUS_OK) {
+        // every encoding is its own representation with its own tag, it is
+        // known before compressing so a 304 only compresses for its length
+        QString etag = headers.value("ETag");
+        if (etag.isEmpty()) {
+            etag = QString("\"%1-%2\"").arg(out.size(), 0, 16).arg(fnv1a(out), 0, 16);
+        }
+
+        if (compressible && m_encoding != QWebCompression::IDENTITY && etag.endsWith('"')) {
+            etag.insert(etag.size() - 1, '-' + QWebCompression::name(m_encoding));
+        }
+
+        headers["ETag"] = etag;
+
+        if (compressible) {
+            QWebCompression::addVary(&headers);
+        }
+
+        if (isNotModified(m_httpRequest, headers)) {
+            const qint64 writeStart = trace ? trace->now() : 0;
+            if (trace) {
+                trace->mark(QWebTrace::SERIALIZE, serializeStart, writeStart);
+            }
+
+            qint64 length = out.size();
+            if (compressible && m_encoding != QWebCompression::IDENTITY) {
+                const QByteArray encoded = QWebCompression::compress(out, m_encoding, m_compression->level);
+                if (!encoded.isEmpty() && encoded.size() < out.size()) {
+                    length = encoded.size();
+                }
+            }
+
+            m_sentStatus = QHttpResponse::STATUS_NOT_MODIFIED;
+            writeNotModified(httpResponse, headers, length);
+
+            if (trace) {
+                trace->mark(QWebTrace::WRITE, writeStart, trace->now());
+            }
+            return SUCCESS;
+        }
+    }
+
+    if (compressible) {
+        // the body depends on Accept-Encoding, even when it is sent as it is
+        QWebCompression::addVary(&headers);
+
+        if (m_encoding != QWebCompression::IDENTITY) {
+            compressed = QWebCompression::compress(out, m_encoding, m_compression->level);
+
+            if (!compressed.isEmpty() && compressed.size() < out.size()) {
+                headers["Content-Encoding"] = QWebCompression::name(m_encoding);
+            } else {
+                compressed.clear();
+            }
+        }
+    }
+
+    const QByteArray &body = compressed.isEmpty() ? out : compressed;
+
+    m_sentStatus = m_status;
+    m_sentBytes = body.length();
+
+    const qint64 writeStart = trace ? trace->now() : 0;
+    if (trace) {
+        trace->mark(QWebTrace::SERIALIZE, serializeStart, writeStart);
+    }
+
+    httpResponse->setHeader("Content-Length", QString::number(body.length()));
+    for (auto it = headers.constBegin(); it != headers.constEnd(); ++it) {
+        httpResponse->setHeader(it.key(), it.value());
     }
 
     httpResponse->writeHead(m_status);
-    httpResponse->write(out);
+    httpResponse->write(body);
     httpResponse->end();
 
+    if (trace) {
+        trace->mark(QWebTrace::WRITE, writeStart, trace->now());
+    }
+
+    if (m_onWritten) {
+        m_onWritten(m_status, headers, body);
+    }
+
     return SUCCESS;
 }
+
+#include "QWebResponse.moc"
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2014 Kevin Brightwell <kevin.brightwell2@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "router/QWebResponseCache.h"
+
+QWebResponseCache::QWebResponseCache(const qint64 maxBytes)
+    : m_entries(),
+      m_head(nullptr),
+      m_tail(nullptr),
+      m_maxBytes(maxBytes),
+      m_bytes(0) {
+
+    m_clock.start();
+}
+
+QWebResponseCache::~QWebResponseCache() {
+    clear();
+}
+
+const QWebResponseCache::Entry *QWebResponseCache::find(const QString &key) {
+    Entry *entry = m_entries.value(key, nullptr);
+    if (!entry) {
+        return nullptr;
+    }
+
+    if (m_clock.elapsed() >= entry->expires) {
+        remove(entry);
+        return nullptr;
+    }
+
+    unlink(entry);
+    pushFront(entry);
+
+    return entry;
+}
+
+void QWebResponseCache::insert(const QString &key, const QHttpResponse::StatusCode status,
+                               const Headers &headers, const QByteArray &body, const int ttl) {
+    Entry *old = m_entries.value(key, nullptr);
+    if (old) {
+        remove(old);
+    }
+
+    qint64 cost = body.size() + key.size() * 2;
+    for (auto it = headers.constBegin(); it != headers.constEnd(); ++it) {
+        cost += (it.key().size() + it.value().size()) * 2;
+    }
+
+    if (cost > m_maxBytes) {
+        return;
+    }
+
+    Entry *entry = new Entry;
+    entry->status = status;
+    entry->headers = headers;
+    entry->body = body;
+    entry->key = key;
+    entry->expires = m_clock.elapsed() + ttl;
+    entry->cost = cost;
+
+    m_entries.insert(key, entry);
+    pushFront(entry);
+    m_bytes += cost;
+
+    // make room from the least recently used end
+    while (m_bytes > m_maxBytes && m_tail) {
+        remove(m_tail);
+    }
+}
+
+void QWebResponseCache::clear() {
+    qDeleteAll(m_entries);
+
+    m_entries.clear();
+    m_head = nullptr;
+    m_tail = nullptr;
+    m_bytes = 0;
+}
+
+void QWebResponseCache::unlink(Entry *entry) {
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        m_head = entry->next;
+    }
+
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    } else {
+        m_tail = entry->prev;
+    }
+
+    entry->prev = nullptr;
+    entry->next = nullptr;
+}
+
+void QWebResponseCache::pushFront(Entry *entry) {
+    entry->next = m_head;
+    if (m_head) {
+        m_head->prev = entry;
+    }
+
+    m_head = entry;
+    if (!m_tail) {
+        m_tail = entry;
+    }
+}
+
+void QWebResponseCache::remove(Entry *entry) {
+    unlink(entry);
+
+    m_entries.remove(entry->key);
+    m_bytes -= entry->cost;
+
+    delete entry;
+}
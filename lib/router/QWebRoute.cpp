@@ -32,6 +32,47 @@
 #include <QDebug>
 #include <QHash>
 
+QHash<QString, QString> QWebRoute::Match::urlParams() const {
+    QHash<QString, QString> out;
+
+    for (int i = 1; i < m_captures.size(); ++i) {
+        const QString n = name(i);
+
+        if (!n.isEmpty() && m_captures[i].first >= 0) {
+            out[n] = captured(i);
+        }
+    }
+
+    return out;
+}
+
+QStringList QWebRoute::Match::splat() const {
+    QStringList out;
+
+    for (int i = 1; i < m_captures.size(); ++i) {
+        if (name(i).isEmpty() && m_captures[i].first >= 0) {
+            out += captured(i);
+        }
+    }
+
+    return out;
+}
+
+QStringList QWebRoute::Match::groups() const {
+    QStringList out;
+    out.reserve(m_captures.size());
+
+    for (int i = 0; i < m_captures.size(); ++i) {
+        out += captured(i);
+    }
+
+    return out;
+}
+
+QWebRoute::ParsedRoute::Ptr QWebRoute::Match::toParsedRoute() const {
+    return ParsedRoute::Ptr(new ParsedRoute(urlParams(), splat(), groups()));
+}
+
 class QWebRoute_Regex : public QObject, public QWebRoute {
 
     Q_OBJECT
@@ -39,12 +80,16 @@ class QWebRoute_Regex : public QObject, public QWebRoute {
 public:
 
     QWebRoute_Regex(const QRegularExpression &route,
+                     const LevelList &levels = LevelList(),
                      QObject *parent = nullptr)
-        : QObject(parent), QWebRoute(route.pattern()), m_urlPattern(route) {
+        : QObject(parent), QWebRoute(route.pattern(), levels), m_urlPattern(route) {
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 4, 0))
         // if on Qt 5.4+ we can optimize the regex
         m_urlPattern.optimize();
 #endif
+
+        // fetched once, rather than on every match
+        _captureNames = m_urlPattern.namedCaptureGroups();
     }
 
     /*!
@@ -54,16 +99,18 @@ public:
      */
     inline
     const QStringList variables() const {
-        return m_urlPattern.namedCaptureGroups();
+        return _captureNames;
     }
 
+    using QWebRoute::checkPath;
+
     /**
      * @brief checkPath use the QRegularExpression module to compute
      * @param paths
      * @return
      */
     virtual
-    ParsedRoute::Ptr const checkPath(const QString &path) {
+    bool checkPath(const QString &path, Match *result) {
         typedef QRegularExpression QRE;
 
         const QRegularExpressionMatch match = m_urlPattern.match(path, 0, QRE::NormalMatch, QRE::AnchoredMatchOption);
@@ -75,28 +122,15 @@ public:
                 qDebug() << "QWebRoute::checkPath(" << path << "): No match was found using '" << m_urlPattern.pattern() << "', but did find partial match.";
             }
             
-            return ParsedRoute::Ptr();
+            return false;
         }
 
-        QHash<QString, QString> namedVars;
-        QStringList splats;
-        const QStringList names = m_urlPattern.namedCaptureGroups();
-        const QStringList vals = match.capturedTexts();
-        for (int i = 1; i < names.size(); ++i) {
-            const QString &name = names[i];
-            const QString &val = vals[i];
-
-            if (!val.isNull()) {
-                if (name.isEmpty()) {
-                    // name is invalid:
-                    splats += val;
-                } else {
-                    namedVars[name] = val;
-                }
-            }
+        result->reset(path, &_captureNames);
+        for (int i = 0; i <= match.lastCapturedIndex(); ++i) {
+            result->addCapture(match.capturedStart(i), match.capturedLength(i));
         }
 
-        return ParsedRoute::Ptr(new ParsedRoute(namedVars, splats, vals));
+        return true;
     }
 
 private:
@@ -104,6 +138,55 @@ private:
 
 };
 
+/**
+ * @brief The QWebRoute_Static class is a route with only literal levels, it is
+ * matched with a string comparison.
+ */
+class QWebRoute_Static : public QWebRoute {
+
+public:
+
+    QWebRoute_Static(const QString &route, const QString &path, const LevelList &levels)
+        : QWebRoute(route, levels),
+          m_path(path) {
+
+    }
+
+    inline
+    const QStringList variables() const {
+        return QStringList();
+    }
+
+    using QWebRoute::checkPath;
+
+    virtual
+    bool checkPath(const QString &path, Match *result) {
+        if (path != m_path) {
+            return false;
+        }
+
+        result->reset(path, &_captureNames);
+        result->addCapture(0, path.size());
+
+        return true;
+    }
+
+    virtual
+    bool isStatic() const {
+        return true;
+    }
+
+    virtual
+    QString staticPath() const {
+        return m_path;
+    }
+
+private:
+
+    //!< The literal levels joined, `route()` stays as registered
+    const QString m_path;
+};
+
 
 QWebRoute::Ptr QWebRouteFactory::createRegex(const QString &comp) const {    
     return createRegex(QRegularExpression(comp));
@@ -159,7 +242,8 @@ QString replaceRE(const QRegularExpression &needle, const QString &haystack, con
 static const QString DEFAULT_PATH_SPECIFICATION = "+";
 
 static
-QString compilePathSyntax(const QString &path, QWebRouteFactory::CreationError * const error) {
+QString compilePathSyntax(const QString &path, QWebRouteFactory::CreationError * const error,
+                          QWebRoute::LevelList * const levels) {
     
     const static QRegularExpression WILDCARD_STAR("(\\*)");
     const static QRegularExpression WILDCARD_PLUS("(\\+)");
@@ -237,10 +321,28 @@ QString compilePathSyntax(const QString &path, QWebRouteFactory::CreationError *
                 }
             }
         }
+
+        // regex to remove extra wildcards, `a++` is `a+` and `a**` is `a*`
+        static const QRegularExpression WILDCARD_STAR_GT2("\\*{2,}");
+        static const QRegularExpression WILDCARD_PLUS_GT2("\\+{2,}");
+
+        // collapsed before the level is kept, so QWebRouteIndex sees what the
+        // compiled expression matches
+        for (QString &spec : specs) {
+            spec = replaceRE(WILDCARD_STAR_GT2, spec, "*");
+            spec = replaceRE(WILDCARD_PLUS_GT2, spec, "+");
+        }
         specs.removeDuplicates();
 
         // now we have `specs` which each one needs to be parse
 
+        // keep the un-compiled level around for QWebRouteIndex
+        QWebRoute::Level parsedLevel;
+        parsedLevel.name = name;
+        parsedLevel.specs = specs;
+        parsedLevel.captured = groupStarted || GROUPING_REQUIRED.match(level).hasMatch();
+        levels->append(parsedLevel);
+
         // GROUPING:
         // ----------
 
@@ -259,19 +361,13 @@ QString compilePathSyntax(const QString &path, QWebRouteFactory::CreationError *
         // WILDCARDS:
         // ----------
 
-        // Fix all of the wildcards within the syntax
-
-        // regex to remove extra wildcards
-        static const QRegularExpression WILDCARD_STAR_GT2("\\*{2,}");
-        static const QRegularExpression WILDCARD_PLUS_GT2("\\+{2,}");
+        // Fix all of the wildcards within the syntax, repeated ones were
+        // collapsed above
 
         // for the OR options, replace wild cards if needed
         for (QString spec : specs) {
             spec = spec.replace('.', "\\.");
 
-            spec = replaceRE(WILDCARD_STAR_GT2, spec, "*");
-            spec = replaceRE(WILDCARD_PLUS_GT2, spec, "+");
-
             spec = replaceRE(WILDCARD_STAR, spec, VALID_NAME_CHARS % '*');
             spec = replaceRE(WILDCARD_PLUS, spec, VALID_NAME_CHARS % '+');
 
@@ -306,7 +402,8 @@ QString compilePathSyntax(const QString &path, QWebRouteFactory::CreationError *
 QWebRoute::Ptr QWebRouteFactory::create(const QString &route) const {
     // create a QRegularExpression from the custom dsl:
     CreationError error = NO_ERROR;
-    QString expr = compilePathSyntax(route, &error);
+    QWebRoute::LevelList levels;
+    QString expr = compilePathSyntax(route, &error, &levels);
 
     if (error != NO_ERROR) {
         setError(error, expr);
@@ -325,7 +422,24 @@ QWebRoute::Ptr QWebRouteFactory::create(const QString &route) const {
 //    qDebug() << "Parsed: '" << route << "' -> '" << re.pattern() << '\'';
 
     clearError();
-    return QWebRoute::Ptr(new QWebRoute_Regex(re));
+
+    // purely literal paths do not need the regex at all
+    bool isStatic = true;
+    QString literal;
+    for (const QWebRoute::Level &level : levels) {
+        if (level.captured || level.specs.size() != 1) {
+            isStatic = false;
+            break;
+        }
+
+        literal += '/' % level.specs.first();
+    }
+
+    if (isStatic) {
+        return QWebRoute::Ptr(new QWebRoute_Static(route, literal, levels));
+    }
+
+    return QWebRoute::Ptr(new QWebRoute_Regex(re, levels));
 }
 
 #include "QWebRoute.moc"
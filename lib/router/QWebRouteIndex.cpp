@@ -0,0 +1,628 @@
+/*
+ * Copyright 2014 Kevin Brightwell <kevin.brightwell2@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "router/QWebRouteIndex.h"
+
+#include <QHash>
+#include <QRegularExpression>
+#include <QRegularExpressionMatch>
+#include <QStringBuilder>
+#include <QStringList>
+#include <QVarLengthArray>
+#include <QVector>
+#include <QDebug>
+
+#include <algorithm>
+#include <limits>
+
+/**
+ * Characters matched by a wildcard, mirrors `[\w\d\-_]` used by the compiled
+ * regular expressions. Without `UseUnicodePropertiesOption` `\w` is ASCII
+ * only, so this is `[A-Za-z0-9_-]`.
+ */
+static inline
+bool isValidChar(const QChar c) {
+    const ushort u = c.unicode();
+    return (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || (u >= '0' && u <= '9')
+            || u == '_' || u == '-';
+}
+
+/**
+ * Matches a single specification (i.e. `foo*`, `+bar`, `a.b`) against the
+ * characters in [`str`, `strEnd`). `*` matches zero or more valid characters
+ * and `+` one or more.
+ */
+static
+bool matchSpec(const QChar *spec, const QChar *specEnd, const QChar *str, const QChar *strEnd) {
+    while (spec != specEnd) {
+        const QChar c = *spec;
+
+        if (c == '*' || c == '+') {
+            const QChar *pos = str;
+            if (c == '+') {
+                if (pos == strEnd || !isValidChar(*pos)) {
+                    return false;
+                }
+
+                ++pos;
+            }
+
+            ++spec;
+
+            // try every length of the wildcard run
+            for (;;) {
+                if (matchSpec(spec, specEnd, pos, strEnd)) {
+                    return true;
+                }
+
+                if (pos == strEnd || !isValidChar(*pos)) {
+                    return false;
+                }
+
+                ++pos;
+            }
+        }
+
+        if (str == strEnd || *str != c) {
+            return false;
+        }
+
+        ++spec;
+        ++str;
+    }
+
+    return str == strEnd;
+}
+
+class QWebRouteIndex::Node {
+public:
+
+    enum Type {
+        //!< Literal level, no capture i.e. `/foo`
+        STATIC,
+
+        //!< Named level with the default specification i.e. `/:name`
+        PARAM,
+
+        //!< Unnamed, lone wildcard i.e. `/*` or `/+`
+        WILDCARD,
+
+        //!< Any other level, i.e. `/foo*|bar`, `/:name$one|two`
+        PATTERN
+    };
+
+    typedef QPair<QString, Node *> StaticChild;
+
+    Node(const Type type = STATIC, const QWebRoute::Level &level = QWebRoute::Level())
+        : type(type), level(level), terminal(-1), minIndex(-1) {
+
+    }
+
+    ~Node() {
+        for (const StaticChild &child : statics) {
+            delete child.second;
+        }
+
+        qDeleteAll(dynamics);
+    }
+
+    static
+    Type typeOf(const QWebRoute::Level &level) {
+        if (!level.captured) {
+            return STATIC;
+        }
+
+        if (level.specs.size() == 1) {
+            const QString &spec = level.specs.first();
+
+            if (!level.name.isNull() && spec == "+") {
+                return PARAM;
+            }
+
+            if (level.name.isNull() && (spec == "+" || spec == "*")) {
+                return WILDCARD;
+            }
+        }
+
+        return PATTERN;
+    }
+
+    /**
+     * Checks if the dynamic level matches the characters in [`str`, `strEnd`).
+     */
+    bool matches(const QChar *str, const QChar *strEnd) const {
+        switch (type) {
+        case PARAM:
+        case WILDCARD: {
+            if (str == strEnd) {
+                return level.specs.first() == "*";
+            }
+
+            for (const QChar *c = str; c != strEnd; ++c) {
+                if (!isValidChar(*c)) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        case PATTERN: {
+            for (const QString &spec : level.specs) {
+                if (matchSpec(spec.constData(), spec.constData() + spec.size(), str, strEnd)) {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        case STATIC:
+        default:
+            break;
+        }
+
+        return false;
+    }
+
+    Node *staticChild(const QString &literal) {
+        auto it = std::lower_bound(statics.begin(), statics.end(), literal,
+                                   [](const StaticChild &child, const QString &key) {
+            return child.first < key;
+        });
+
+        if (it == statics.end() || it->first != literal) {
+            it = statics.insert(it, StaticChild(literal, new Node()));
+        }
+
+        return it->second;
+    }
+
+    const Node *findStatic(const QStringRef &literal) const {
+        auto it = std::lower_bound(statics.constBegin(), statics.constEnd(), literal,
+                                   [](const StaticChild &child, const QStringRef &key) {
+            return key.compare(child.first) > 0;
+        });
+
+        if (it == statics.constEnd() || literal.compare(it->first) != 0) {
+            return nullptr;
+        }
+
+        return it->second;
+    }
+
+    Node *dynamicChild(const QWebRoute::Level &level) {
+        for (Node *child : dynamics) {
+            if (child->level.name == level.name && child->level.specs == level.specs) {
+                return child;
+            }
+        }
+
+        Node *child = new Node(typeOf(level), level);
+        dynamics += child;
+
+        return child;
+    }
+
+    /**
+     * Inserts `levels[depth..]` of the route at `index` below this node.
+     */
+    void insert(const QWebRoute::LevelList &levels, const int depth, const int index) {
+        if (minIndex < 0) {
+            // routes are inserted in order, the first one seen is the lowest
+            minIndex = index;
+        }
+
+        if (depth == levels.size()) {
+            if (terminal < 0) {
+                terminal = index;
+            }
+
+            return;
+        }
+
+        const QWebRoute::Level &next = levels[depth];
+
+        if (!next.captured) {
+            // every literal alternative gets its own branch
+            for (const QString &spec : next.specs) {
+                staticChild(spec)->insert(levels, depth + 1, index);
+            }
+        } else {
+            dynamicChild(next)->insert(levels, depth + 1, index);
+        }
+    }
+
+    //!< How the level leading to this node is matched
+    const Type type;
+
+    //!< Level leading to this node, only set for dynamic nodes
+    const QWebRoute::Level level;
+
+    //!< Literal children, sorted by literal for binary searching
+    QVector<StaticChild> statics;
+
+    //!< Children needing a check per path, ordered by `minIndex`
+    QList<Node *> dynamics;
+
+    //!< First route index that terminates at this node, -1 if none
+    int terminal;
+
+    //!< Lowest route index found anywhere in this sub-tree
+    int minIndex;
+};
+
+/**
+ * Depth first search through the tree, keeping the lowest route index and the
+ * captures made on the way to it.
+ */
+class QWebRouteIndex_Search {
+public:
+
+    //!< Start and length of a captured level
+    typedef QPair<int, int> Capture;
+
+    typedef QVarLengthArray<Capture, 16> CaptureList;
+
+    explicit QWebRouteIndex_Search(const QString &path)
+        : path(path), best(std::numeric_limits<int>::max()) {
+        // split the path into levels, keeping empty levels
+        int start = 1;
+        for (int i = 1; i <= path.size(); ++i) {
+            if (i == path.size() || path.at(i) == '/') {
+                bounds.append(qMakePair(start, i - start));
+                start = i + 1;
+            }
+        }
+    }
+
+    void search(const QWebRouteIndex::Node *node, const int depth) {
+        typedef QWebRouteIndex::Node Node;
+
+        if (node->minIndex < 0 || node->minIndex >= best) {
+            // nothing better below here
+            return;
+        }
+
+        if (depth == bounds.size()) {
+            if (node->terminal >= 0 && node->terminal < best) {
+                best = node->terminal;
+                bestCaptures = captures;
+            }
+
+            return;
+        }
+
+        const int start = bounds[depth].first;
+        const int length = bounds[depth].second;
+
+        const Node *child = node->findStatic(path.midRef(start, length));
+        if (child) {
+            search(child, depth + 1);
+        }
+
+        const QChar *str = path.constData() + start;
+        for (const Node *dyn : node->dynamics) {
+            if (dyn->minIndex >= best) {
+                // children are ordered, none of the rest can be better
+                break;
+            }
+
+            if (dyn->matches(str, str + length)) {
+                captures.append(Capture(start, length));
+
+                search(dyn, depth + 1);
+
+                captures.removeLast();
+            }
+        }
+    }
+
+    /**
+     * Fills `match` with the captures of the best route found
+     */
+    void fill(QWebRoute::Match *match, const QStringList *names) const {
+        match->reset(path, names);
+        match->addCapture(0, path.size());
+
+        for (const Capture &capture : bestCaptures) {
+            match->addCapture(capture.first, capture.second);
+        }
+    }
+
+    const QString &path;
+
+    QVarLengthArray<QPair<int, int>, 16> bounds;
+
+    CaptureList captures;
+
+    CaptureList bestCaptures;
+
+    int best;
+};
+
+/**
+ * @brief The Automaton class matches a batch of DSL routes with a single
+ * regular expression, `^(?:(route0)|(route1)|...)$`. Each route's group
+ * ("tag") tells which route matched, PCRE picks the first alternative that
+ * matches which keeps the registration order.
+ */
+class QWebRouteIndex::Automaton {
+public:
+
+    struct Branch {
+        //!< Index of the route
+        int index;
+
+        //!< Capture group wrapping the route
+        int tag;
+
+        //!< Names of the route's captures, see QWebRoute::captureNames
+        const QStringList *names;
+    };
+
+    Automaton()
+        : m_groupCount(0) {
+
+    }
+
+    /**
+     * Compiles a level to a regex, the same way as QWebRouteFactory::create
+     * except named groups become unnamed groups
+     */
+    static
+    QString levelPattern(const QWebRoute::Level &level) {
+        static const QString VALID_NAME_CHARS("[\\w\\d\\-_]");
+
+        QStringList specs;
+        for (const QString &spec : level.specs) {
+            QString out;
+            out.reserve(spec.size() * 2);
+
+            for (const QChar c : spec) {
+                if (c == '*' || c == '+') {
+                    out += VALID_NAME_CHARS % c;
+                } else if (c == '.') {
+                    out += "\\.";
+                } else {
+                    out += c;
+                }
+            }
+
+            specs += out;
+        }
+
+        if (level.captured) {
+            return '(' % specs.join('|') % ')';
+        } else if (specs.size() >= 2) {
+            return "(?:" % specs.join('|') % ')';
+        }
+
+        return specs.first();
+    }
+
+    void add(const int index, const QWebRoute &route) {
+        Branch branch;
+        branch.index = index;
+        branch.tag = ++m_groupCount;
+        branch.names = &route.captureNames();
+
+        QString pattern = "(";
+        for (const QWebRoute::Level &level : route.levels()) {
+            pattern += '/' % levelPattern(level);
+
+            if (level.captured) {
+                ++m_groupCount;
+            }
+        }
+        pattern += ')';
+
+        m_patterns += pattern;
+        branches += branch;
+    }
+
+    bool compile() {
+        regex.setPattern("^(?:" % m_patterns.join('|') % ")$");
+        m_patterns.clear();
+
+        if (!regex.isValid()) {
+            return false;
+        }
+
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 4, 0))
+        regex.optimize();
+#endif
+
+        return true;
+    }
+
+    int match(const QString &path, QWebRoute::Match *result) const {
+        typedef QRegularExpression QRE;
+
+        const QRegularExpressionMatch match = regex.match(path, 0, QRE::NormalMatch, QRE::AnchoredMatchOption);
+        if (!match.hasMatch()) {
+            return -1;
+        }
+
+        for (const Branch &branch : branches) {
+            if (match.capturedStart(branch.tag) < 0) {
+                continue;
+            }
+
+            // same captures as QWebRoute_Regex::checkPath
+            result->reset(path, branch.names);
+            result->addCapture(match.capturedStart(0), match.capturedLength(0));
+
+            for (int i = 1; i < branch.names->size(); ++i) {
+                result->addCapture(match.capturedStart(branch.tag + i), match.capturedLength(branch.tag + i));
+            }
+
+            return branch.index;
+        }
+
+        return -1;
+    }
+
+    QRegularExpression regex;
+
+    QVector<Branch> branches;
+
+private:
+
+    QStringList m_patterns;
+
+    int m_groupCount;
+};
+
+/**
+ * Number of routes put in a single Automaton, PCRE limits the size of a
+ * compiled pattern so very large route tables are split up.
+ */
+static const int MAX_AUTOMATON_ROUTES = 128;
+
+QWebRouteIndex::QWebRouteIndex(const QList<QWebRoute::Ptr> &routes, const Strategy strategy)
+    : m_routes(routes), m_root(new Node()), m_strategy(strategy) {
+
+    Automaton *automaton = nullptr;
+    QList<QPair<int, QWebRoute::Ptr> > batch;
+
+    for (int i = 0; i < routes.size(); ++i) {
+        const QWebRoute::Ptr &route = routes[i];
+
+        if (route->levels().isEmpty()) {
+            m_regexRoutes += qMakePair(i, route);
+        } else if (strategy == LEVEL_TREE) {
+            m_root->insert(route->levels(), 0, i);
+        } else {
+            if (!automaton) {
+                automaton = new Automaton();
+            }
+
+            automaton->add(i, *route);
+            batch += qMakePair(i, route);
+
+            if (batch.size() == MAX_AUTOMATON_ROUTES || i == routes.size() - 1) {
+                if (automaton->compile()) {
+                    m_automata += automaton;
+                } else {
+                    // too large or unsupported, check the routes one by one instead
+                    qDebug() << "QWebRouteIndex: Could not combine routes:" << automaton->regex.errorString();
+
+                    delete automaton;
+                    m_regexRoutes += batch;
+                }
+
+                automaton = nullptr;
+                batch.clear();
+            }
+        }
+    }
+
+    if (automaton) {
+        // the last route was a regex route, finish the batch
+        if (automaton->compile()) {
+            m_automata += automaton;
+        } else {
+            delete automaton;
+            m_regexRoutes += batch;
+        }
+    }
+
+    std::sort(m_regexRoutes.begin(), m_regexRoutes.end(),
+              [](const QPair<int, QWebRoute::Ptr> &a, const QPair<int, QWebRoute::Ptr> &b) {
+        return a.first < b.first;
+    });
+
+    // resolve static paths now, an earlier route may still shadow them
+    for (const QWebRoute::Ptr &route : routes) {
+        if (route->isStatic() && !m_statics.contains(route->staticPath())) {
+            QWebRoute::Match match;
+            const int found = searchRoutes(route->staticPath(), &match);
+
+            m_statics.insert(route->staticPath(), StaticMatch(found, match));
+        }
+    }
+}
+
+QWebRouteIndex::~QWebRouteIndex() {
+    delete m_root;
+    qDeleteAll(m_automata);
+}
+
+int QWebRouteIndex::match(const QString &path, QWebRoute::Match *match) const {
+    const auto it = m_statics.constFind(path);
+    if (it != m_statics.constEnd()) {
+        *match = it->second;
+
+        return it->first;
+    }
+
+    return searchRoutes(path, match);
+}
+
+int QWebRouteIndex::match(const QString &path, QWebRoute::ParsedRoute::Ptr *parsed) const {
+    QWebRoute::Match result;
+
+    const int found = match(path, &result);
+    if (found >= 0) {
+        *parsed = result.toParsedRoute();
+    }
+
+    return found;
+}
+
+int QWebRouteIndex::searchRoutes(const QString &path, QWebRoute::Match *match) const {
+    int found = -1;
+
+    if (m_strategy == COMBINED_REGEX) {
+        // automata are in registration order, the first hit is the lowest
+        for (const Automaton *automaton : m_automata) {
+            found = automaton->match(path, match);
+            if (found >= 0) {
+                break;
+            }
+        }
+    } else if (path.startsWith('/')) {
+        QWebRouteIndex_Search search(path);
+        search.search(m_root, 0);
+
+        if (search.best != std::numeric_limits<int>::max()) {
+            found = search.best;
+            search.fill(match, &m_routes[found]->captureNames());
+        }
+    }
+
+    // regex routes registered before the tree's match still take precedence
+    for (const QPair<int, QWebRoute::Ptr> &pair : m_regexRoutes) {
+        if (found >= 0 && pair.first >= found) {
+            break;
+        }
+
+        if (pair.second->checkPath(path, match)) {
+            found = pair.first;
+
+            break;
+        }
+    }
+
+    return found;
+}
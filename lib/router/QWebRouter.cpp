@@ -25,9 +25,16 @@
 #include "router/QWebRoute.h"
 #include "router/QWebRequest.h"
 #include "router/QWebResponse.h"
+#include "router/QWebResponseCache.h"
+#include "router/QWebAccessLog.h"
+#include "router/QWebTracer.h"
 
+#include <QDateTime>
 #include <QDebug>
+#include <QPointer>
 #include <QSharedPointer>
+#include <QTimer>
+#include <QUrl>
 
 #include <QHttpServer/qhttpresponse.h>
 #include <QHttpServer/qhttprequest.h>
@@ -53,90 +60,582 @@ const QWebRouter::RouteFunction QWebRouter::DEFAULT_404 = [](QSharedPointer<QWeb
                                             req->path()), "text/html");
     };
 
-QWebRouter::QWebRouter(const QHash<QWebService::HttpMethod, RoutePairList> routes,
+QString QWebRouter::methodName(const QWebService::HttpMethod method) {
+    switch (method) {
+    case QWebService::HttpMethod::HTTP_DELETE: return "DELETE";
+    case QWebService::HttpMethod::HTTP_GET: return "GET";
+    case QWebService::HttpMethod::HTTP_HEAD: return "HEAD";
+    case QWebService::HttpMethod::HTTP_POST: return "POST";
+    case QWebService::HttpMethod::HTTP_PUT: return "PUT";
+    case QWebService::HttpMethod::HTTP_OPTIONS: return "OPTIONS";
+    case QWebService::HttpMethod::HTTP_PATCH: return "PATCH";
+    default: return QString();
+    }
+}
+
+QWebRouter::QWebRouter(const QHash<QWebService::HttpMethod, RouteEntryList> routes,
                          const RouteFunction fourohfour,
+                         const QWebRouteIndex::Strategy strategy,
+                         const Settings &settings,
                          QObject* parent)
     : QObject(parent),
-      m_routes(routes),
       m_404(fourohfour),
-      m_service(nullptr) {
-    
+      m_settings(settings),
+      m_service(nullptr),
+      m_cache(settings.cacheSize > 0 ? new QWebResponseCache(settings.cacheSize) : nullptr),
+      m_shard(nullptr),
+      m_unmatchedMetricsId(-1),
+      m_logCount(0),
+      m_traceCount(0),
+      m_clock() {
+
+    for (auto it = routes.constBegin(); it != routes.constEnd(); ++it) {
+        if (it.key() < 0 || it.key() >= METHOD_COUNT || it.value().isEmpty()) {
+            continue;
+        }
+
+        MethodTable &table = m_table[it.key()];
+        QList<QSharedPointer<QWebRoute> > methodRoutes;
+
+        table.entries.reserve(it.value().size());
+        for (const RouteEntry &entry : it.value()) {
+            table.entries += entry;
+            methodRoutes += entry.route;
+        }
+
+        table.index = QWebRouteIndex::Ptr(new QWebRouteIndex(methodRoutes, strategy));
+    }
+
+    // every route is registered before the first shard is added
+    if (m_settings.metrics) {
+        for (int method = 0; method < METHOD_COUNT; ++method) {
+            const QString name = methodName(static_cast<QWebService::HttpMethod>(method));
+
+            for (RouteEntry &entry : m_table[method].entries) {
+                entry.metricsId = m_settings.metrics->addRoute(name, entry.route->route());
+            }
+        }
+
+        m_unmatchedMetricsId = m_settings.metrics->addRoute("*", "<unmatched>");
+        m_shard = m_settings.metrics->addShard();
+    }
+
+    m_clock.start();
+}
+
+QWebRouter::QWebRouter(const QWebRouter *other, QObject* parent)
+    : QObject(parent),
+      m_404(other->m_404),
+      m_settings(other->m_settings),
+      m_service(other->m_service),
+      m_cache(m_settings.cacheSize > 0 ? new QWebResponseCache(m_settings.cacheSize) : nullptr),
+      m_shard(m_settings.metrics ? m_settings.metrics->addShard() : nullptr),
+      m_unmatchedMetricsId(other->m_unmatchedMetricsId),
+      m_logCount(0),
+      m_traceCount(0),
+      m_clock() {
+
+    // entries and indexes are never modified after construction, only the
+    // containers are copied
+    for (int i = 0; i < METHOD_COUNT; ++i) {
+        m_table[i] = other->m_table[i];
+    }
+
+    m_clock.start();
 }
 
 QWebRouter::~QWebRouter()
 {
-
+    delete m_cache;
 }
 
-inline
-void parsePOSTVars(QString query, QHash<QString, QString> &out) {
-    const QStringList pairs = query.split('&', QString::SkipEmptyParts);
+const QWebRouter::RouteEntry *QWebRouter::findRoute(const QWebService::HttpMethod method,
+                                                    const QString &path,
+                                                    QWebRoute::Match *match) const {
+    if (method < 0 || method >= METHOD_COUNT) {
+        return nullptr;
+    }
 
-    for (QString pair : pairs) {
-        const QStringList keyVals = pair.split('=', QString::KeepEmptyParts);
+    const MethodTable &table = m_table[method];
+    if (!table.index) {
+        return nullptr;
+    }
 
-        out[keyVals[0]] = keyVals[1];
+    const int found = table.index->match(path, match);
+    if (found < 0) {
+        return nullptr;
     }
+
+    return &table.entries.at(found);
+}
+
+/**
+ * True if `request` announced a body, answering early leaves it unread.
+ */
+static inline
+bool hasBody(const QHttpRequest *request) {
+    const QHash<QString, QString> &headers = request->headers();
+
+    return headers.contains("transfer-encoding")
+            || headers.value("content-length", "0") != "0";
 }
 
 void QWebRouter::handleRoute(QHttpRequest* request, QHttpResponse* resp)
 {
-    qDebug() << request->methodString() << ":" << request->url();
-   
-    const QString route = request->path();
-    request->storeBody();
-    
-    QHash<QString, QString> postParams;
+    // query and form parameters are parsed by QWebRequest::queryParams()
+
+    // we recieved a request, route it before any of the body is read:
+    const qint64 started = m_shard || m_settings.accessLog ? m_clock.nsecsElapsed() : 0;
+
+    // head sampling, the decision is made before anything else is done
+    QSharedPointer<QWebTrace> trace;
+    if (m_settings.tracer && ++m_traceCount % quint64(qMax(1, m_settings.tracer->settings().sampleEvery)) == 0) {
+        trace = QSharedPointer<QWebTrace>(new QWebTrace(m_settings.tracer));
+    }
+
+    const qint64 routeStart = trace ? trace->now() : 0;
+
+    QWebRoute::Match match;
+    const RouteEntry *entry = findRoute(request->method(), request->path(), &match);
+
+    if (trace) {
+        trace->mark(QWebTrace::ROUTE, routeStart, trace->now());
+        trace->method = request->method();
+        trace->route = entry ? entry->route->route() : QString();
+        trace->path = request->path();
+    }
+
+    // without middleware nothing can turn a request away, cached responses
+    // are sent before a request or response is even created, and not traced
+    const QString cached = cacheKey(request, entry);
+    if (!cached.isEmpty() && entry->middleware.isEmpty() && writeCached(cached, entry, request, resp, started)) {
+        return;
+    }
+
+    // captures are only copied out of the path if the handler asks for them
+    QSharedPointer<QWebRequest> reqPtr = QWebRequest::create(request, match);
+    reqPtr->m_metricsId = entry ? entry->metricsId : m_unmatchedMetricsId;
+    reqPtr->m_route = entry ? entry->route.data() : nullptr;
+    reqPtr->m_started = started;
+    reqPtr->m_trace = trace;
+
+    QSharedPointer<QWebResponse> webRespPtr = QWebResponse::create();
+    webRespPtr->setJsonFormat(m_settings.jsonFormat);
+
+    if (m_settings.compression.enabled()) {
+        webRespPtr->m_compression = &m_settings.compression;
+    }
+
+    if (!entry) {
+        handleUnmatched(reqPtr, webRespPtr, resp);
+        return;
+    }
+
+    webRespPtr->m_conditional = entry->conditional;
+
+    const qint64 maxBodySize = entry->maxBodySize >= 0 ? entry->maxBodySize : m_settings.maxBodySize;
+
+    // the body may still arrive after the router is gone
+    const QPointer<QWebRouter> self(this);
+
+    const auto tooLarge = [self, reqPtr, resp]() {
+        QSharedPointer<QWebResponse> error = QWebResponse::create();
+        error->setStatusCode(QWebResponse::StatusCode::STATUS_REQUEST_ENTITY_TOO_LARGE);
+        error->setHeader("Connection", "close");
+        error->writeText("413 Request Entity Too Large");
+
+        if (self) {
+            self->writeResponse(reqPtr, error, resp);
+        } else {
+            error->writeToResponse(reqPtr, resp);
+        }
+    };
+
+    if (maxBodySize >= 0) {
+        bool ok = false;
+        const qint64 length = request->headers().value("content-length").toLongLong(&ok);
+
+        if (ok && length > maxBodySize) {
+            tooLarge();
+            return;
+        }
+    }
+
+    const bool stream = entry->streamBody;
+
+    // chunked bodies have no length up front, they are checked as they arrive
+    connect(request, &QHttpRequest::data, [reqPtr, webRespPtr, maxBodySize, stream, tooLarge](const QByteArray &chunk) {
+        if (reqPtr->m_bodyRejected) {
+            return;
+        }
+
+        reqPtr->m_bodySize += chunk.size();
+
+        if (maxBodySize >= 0 && reqPtr->m_bodySize > maxBodySize) {
+            reqPtr->m_bodyRejected = true;
+            reqPtr->m_body.clear();
+
+            if (!stream) {
+                tooLarge();
+            } else {
+                emit reqPtr->bodyAborted();
+
+                // the handler already ran, answer for it unless it has
+                if (!webRespPtr->m_written && webRespPtr->expire()) {
+                    tooLarge();
+                }
+            }
+            return;
+        }
+
+        if (stream) {
+            emit reqPtr->bodyData(chunk);
+        } else {
+            reqPtr->m_body.append(chunk);
+        }
+    });
+
+    if (stream) {
+        reqPtr->m_bodyStreamed = true;
+
+        // the handler is called right away and reads the body as it arrives
+        connect(request, &QHttpRequest::end, [reqPtr]() {
+            if (!reqPtr->m_bodyRejected) {
+                emit reqPtr->bodyEnd();
+            }
+        });
+
+        const qint64 handlerStart = trace ? trace->now() : 0;
+
+        if (QWebMiddleWare::run(entry->middleware, reqPtr, webRespPtr)) {
+            entry->func(reqPtr, webRespPtr);
+        }
+
+        if (trace) {
+            trace->mark(QWebTrace::HANDLER, handlerStart, trace->now());
+        }
+
+        respond(reqPtr, webRespPtr, resp);
+        return;
+    }
+
+    connect(request, &QHttpRequest::end, [this, entry, reqPtr, resp, webRespPtr, cached]() {
+        if (reqPtr->m_bodyRejected) {
+            return;
+        }
+
+        QWebTrace * const trace = reqPtr->m_trace.data();
+        const qint64 handlerStart = trace ? trace->now() : 0;
+        if (trace) {
+            trace->mark(QWebTrace::BODY, trace->end(QWebTrace::ROUTE), handlerStart);
+        }
+
+        // we found a proper route, middleware may answer instead:
+        if (QWebMiddleWare::run(entry->middleware, reqPtr, webRespPtr)) {
+            if (!cached.isEmpty()) {
+                // keeps what the middleware set, CORS headers for example
+                if (writeCached(cached, entry, reqPtr->httpRequest(), resp, reqPtr->m_started,
+                                webRespPtr->m_headers)) {
+                    return;
+                }
+
+                cacheOnWrite(webRespPtr, cached, entry->cacheTtl);
+            }
+
+            entry->func(reqPtr, webRespPtr);
+        }
+
+        if (trace) {
+            trace->mark(QWebTrace::HANDLER, handlerStart, trace->now());
+        }
+
+        respond(reqPtr, webRespPtr, resp);
+    });
+}
+
+QString QWebRouter::cacheKey(const QHttpRequest *request, const RouteEntry *entry) const {
+    if (!m_cache || !entry || entry->cacheTtl <= 0 || entry->streamBody
+            || request->method() != QHttpRequest::HTTP_GET) {
+        return QString();
+    }
+
+    QString key = request->path();
+
+    // compressed and plain bodies are cached apart
+    if (m_settings.compression.level > 0) {
+        key += QChar(0);
+        key += QWebCompression::name(QWebCompression::negotiate(request->headers().value("accept-encoding")));
+    }
+
+    if (entry->cacheKeys.isEmpty()) {
+        return key;
+    }
+
+    QHash<QString, QString> query;
     if (request->url().hasQuery()) {
-        parsePOSTVars(request->url().query(), postParams);
+        QWebRequest::parseQuery(request->url().query(QUrl::FullyEncoded).toLatin1(), &query);
     }
 
-    if (request->method() == QWebService::HttpMethod::HTTP_POST) {
-        QString bodyVals = QString(request->body());
+    // decoded values may hold any character but NUL
+    for (const QString &name : entry->cacheKeys) {
+        key += QChar(0);
+        key += query.value(name);
+    }
 
-        parsePOSTVars(bodyVals, postParams);
+    return key;
+}
+
+bool QWebRouter::writeCached(const QString &key, const RouteEntry *entry,
+                             const QHttpRequest *request, QHttpResponse *resp,
+                             const qint64 started, const QHash<QString, QString> &extraHeaders) {
+    const QWebResponseCache::Entry *cached = m_cache->find(key);
+    if (!cached) {
+        return false;
     }
 
-    // we recieved a request:
-    QWebRoute::ParsedRoute::Ptr routeResponse;
-    QWebRouter::RouteFunction func;
-    
-    QWebService::HttpMethod method = request->method();
-    RoutePairList routes = m_routes[method];
-  
-    // search for the first matching path
-    for (RoutePair pair : routes) {
-        QSharedPointer<QWebRoute::ParsedRoute> resp = pair.first->checkPath(route);
-        if (resp) {
-            func = pair.second;
-            routeResponse = resp;
+    // the cached representation wins over headers of the same name
+    QHash<QString, QString> headers = extraHeaders;
+    for (auto it = cached->headers.constBegin(); it != cached->headers.constEnd(); ++it) {
+        headers[it.key()] = it.value();
+    }
+
+    if (entry->conditional && QWebResponse::isNotModified(request, headers)) {
+        QWebResponse::writeNotModified(resp, headers, cached->body.length());
+        record(request, entry->route.data(), entry->metricsId, started, QHttpResponse::STATUS_NOT_MODIFIED, 0);
+        return true;
+    }
+
+    resp->setHeader("Content-Length", QString::number(cached->body.length()));
+    for (auto it = headers.constBegin(); it != headers.constEnd(); ++it) {
+        resp->setHeader(it.key(), it.value());
+    }
+
+    // the body is never read, close the connection instead of draining it
+    if (hasBody(request)) {
+        resp->setHeader("Connection", "close");
+    }
+
+    resp->writeHead(cached->status);
+    resp->write(cached->body);
+    resp->end();
+
+    record(request, entry->route.data(), entry->metricsId, started, cached->status, cached->body.length());
+
+    return true;
+}
+
+/**
+ * True if a response with `headers` may be sent to other clients, it is not
+ * if it sets a cookie or is marked private.
+ */
+static
+bool isShareable(const QHash<QString, QString> &headers) {
+    for (auto it = headers.constBegin(); it != headers.constEnd(); ++it) {
+        if (it.key().compare("Set-Cookie", Qt::CaseInsensitive) == 0) {
+            return false;
+        }
+
+        if (it.key().compare("Cache-Control", Qt::CaseInsensitive) == 0
+                && (it.value().contains("private", Qt::CaseInsensitive)
+                    || it.value().contains("no-store", Qt::CaseInsensitive))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * The headers of `headers` describing the body, the only ones replayed from
+ * the cache. Anything else may be specific to the request it answered.
+ */
+static
+QHash<QString, QString> representationHeaders(const QHash<QString, QString> &headers) {
+    static const char * const KEPT[] = {
+        "Content-Type", "Content-Encoding", "ETag", "Last-Modified", "Vary"
+    };
+
+    QHash<QString, QString> kept;
+    for (auto it = headers.constBegin(); it != headers.constEnd(); ++it) {
+        for (const char *name : KEPT) {
+            if (it.key().compare(QLatin1String(name), Qt::CaseInsensitive) == 0) {
+                kept.insert(it.key(), it.value());
+                break;
+            }
+        }
+    }
+
+    return kept;
+}
+
+void QWebRouter::cacheOnWrite(const QSharedPointer<QWebResponse> &webResp, const QString &key, const int ttl) {
+    // deferred responses may be written after the router is gone
+    const QPointer<QWebRouter> self(this);
+
+    webResp->m_onWritten = [self, key, ttl](const QWebResponse::StatusCode status,
+                                            const QHash<QString, QString> &headers,
+                                            const QByteArray &body) {
+        if (self && status == QWebResponse::StatusCode::STATUS_OK && isShareable(headers)) {
+            self->m_cache->insert(key, status, representationHeaders(headers), body, ttl);
+        }
+    };
+}
 
-            break;
+void QWebRouter::logAccess(const QHttpRequest *request, const QWebRoute *route,
+                           const qint64 latency, const int status, const qint64 bytes) {
+    QWebAccessLog *log = m_settings.accessLog.data();
+
+    // errors are always logged, everything else is sampled per worker
+    if (status < 500 && ++m_logCount % quint64(qMax(1, log->settings().sampleEvery)) != 0) {
+        return;
+    }
+
+    QWebAccessLog::Record entry;
+    entry.time = QDateTime::currentMSecsSinceEpoch();
+    entry.status = status;
+    entry.bytes = bytes;
+    entry.latency = latency;
+
+    if (route) {
+        entry.route = route->route();
+    }
+
+    if (request) {
+        entry.method = request->method();
+        entry.peer = request->remoteAddress();
+
+        if (log->needsPath()) {
+            // encoded, a decoded path could carry spaces or line breaks
+            entry.path = request->url().path(QUrl::FullyEncoded);
         }
     }
 
-    QSharedPointer<QWebRequest> reqPtr;
+    log->append(entry);
+}
+
+void QWebRouter::handleUnmatched(const QSharedPointer<QWebRequest> &req,
+                                 const QSharedPointer<QWebResponse> &webResp,
+                                 QHttpResponse *resp) {
+    QHttpRequest *request = req->httpRequest();
+
+    // the 405 lookup and the 404 handler are the handler of the request
+    QWebTrace * const trace = req->m_trace.data();
+    const qint64 handlerStart = trace ? trace->now() : 0;
+
+    // the body is never read, close the connection instead of draining it
+    if (hasBody(request)) {
+        webResp->setHeader("Connection", "close");
+    }
 
-    if (routeResponse) {
-        reqPtr = QWebRequest::create(request, postParams,
-                                     routeResponse->urlParams(),
-                                     routeResponse->splat());
+    QStringList allowed;
+    for (int method = 0; method < METHOD_COUNT; ++method) {
+        const QWebService::HttpMethod httpMethod = static_cast<QWebService::HttpMethod>(method);
+        const QString name = methodName(httpMethod);
+
+        QWebRoute::Match match;
+        if (!name.isEmpty() && findRoute(httpMethod, request->path(), &match)) {
+            allowed += name;
+        }
+    }
+
+    if (!allowed.isEmpty()) {
+        webResp->setStatusCode(QWebResponse::StatusCode::STATUS_METHOD_NOT_ALLOWED);
+        webResp->setHeader("Allow", allowed.join(", "));
+        webResp->writeText("405 Method Not Allowed");
     } else {
-        reqPtr = QWebRequest::create(request, postParams, QHash<QString, QString>(), QStringList());
+        // 404:
+        m_404(req, webResp);
     }
 
-    QSharedPointer<QWebResponse> webRespPtr = QWebResponse::create();
+    if (trace) {
+        trace->mark(QWebTrace::HANDLER, handlerStart, trace->now());
+    }
 
-    connect(request, &QHttpRequest::end, [this, func, reqPtr, resp, webRespPtr]() {
-        if (func) {
-            // we found a proper route:
-            func(reqPtr, webRespPtr);
-        } else {
-            // 404:
-            m_404(reqPtr, webRespPtr);
+    respond(req, webResp, resp);
+}
+
+void QWebRouter::respond(const QSharedPointer<QWebRequest> &req,
+                         const QSharedPointer<QWebResponse> &webResp,
+                         QHttpResponse *resp) {
+    if (webResp->isDeferred()) {
+        waitForResponse(req, webResp, resp);
+    } else {
+        writeResponse(req, webResp, resp);
+    }
+}
+
+void QWebRouter::writeResponse(const QSharedPointer<QWebRequest> &req,
+                               const QSharedPointer<QWebResponse> &webResp,
+                               QHttpResponse *resp) {
+    webResp->m_trace = req->m_trace;
+
+    if (webResp->writeToResponse(req, resp) == QWebResponse::SUCCESS) {
+        record(req->httpRequest(), req->m_route, req->m_metricsId, req->m_started,
+               webResp->m_sentStatus, webResp->m_sentBytes);
+
+        if (req->m_trace) {
+            m_settings.tracer->finish(*req->m_trace, webResp->m_sentStatus);
+        }
+    }
+}
+
+void QWebRouter::waitForResponse(const QSharedPointer<QWebRequest> &req,
+                                 const QSharedPointer<QWebResponse> &webResp,
+                                 QHttpResponse *resp) {
+    // the connection may close while the handler is still working
+    const QPointer<QHttpResponse> out(resp);
+
+    // doubles as the context of the connections, they go when it is deleted
+    QTimer *timer = new QTimer(this);
+    timer->setSingleShot(true);
+
+    // without a timeout a handler may never finish, the connection closing
+    // is then the last chance to let go of the timer and what it holds
+    connect(resp, &QObject::destroyed, timer, &QObject::deleteLater);
+
+    // traces the time from the handler returning to the response being done
+    const auto waited = [req]() {
+        QWebTrace * const trace = req->m_trace.data();
+        if (trace) {
+            trace->mark(QWebTrace::WAIT, trace->end(QWebTrace::HANDLER), trace->now());
         }
+    };
 
-        webRespPtr->writeToResponse(reqPtr, resp);
+    // finish() may be called on another thread, this is queued back to ours
+    connect(webResp.data(), &QWebResponse::finished, timer, [this, req, webResp, out, timer, waited]() {
+        timer->deleteLater();
+
+        if (out) {
+            waited();
+            writeResponse(req, webResp, out);
+        }
     });
+
+    if (m_settings.asyncTimeout > 0) {
+        connect(timer, &QTimer::timeout, [this, req, webResp, out, timer, waited]() {
+            timer->deleteLater();
+
+            if (webResp->expire() && out) {
+                waited();
+
+                QSharedPointer<QWebResponse> timeout = QWebResponse::create();
+                timeout->setStatusCode(QWebResponse::StatusCode::STATUS_GATEWAY_TIMEOUT);
+                timeout->writeText("504 Gateway Timeout");
+                writeResponse(req, timeout, out);
+            }
+        });
+
+        timer->start(m_settings.asyncTimeout);
+    }
+
+    // the handler may have finished before it returned
+    if (webResp->isFinished()) {
+        timer->deleteLater();
+
+        if (out) {
+            waited();
+            writeResponse(req, webResp, out);
+        }
+    }
 }
 
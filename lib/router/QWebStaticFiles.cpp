@@ -0,0 +1,367 @@
+/*
+ * Copyright 2014 Kevin Brightwell <kevin.brightwell2@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "router/QWebStaticFiles.h"
+
+#include "router/QWebRequest.h"
+#include "router/QWebResponse.h"
+#include "router/QWebRouter.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMimeDatabase>
+#include <QMutexLocker>
+#include <QStringList>
+
+#include <QHttpServer/qhttprequest.h>
+
+#include <limits>
+
+QWebStaticFiles::QWebStaticFiles(const QString &prefix, const QString &root, const qint64 cacheSize,
+                                 QObject *parent)
+    : QObject(parent),
+      m_prefix(prefix),
+      m_root(QFileInfo(root).canonicalFilePath()),
+      m_lock(),
+      m_cache(int(qMin<qint64>(cacheSize, std::numeric_limits<int>::max()))),
+      m_watcher(),
+      m_watched(),
+      m_compression(),
+      m_404(QWebRouter::DEFAULT_404) {
+
+    if (m_root.isEmpty()) {
+        qDebug() << "QWebStaticFiles: Directory does not exist:" << root;
+    }
+
+    connect(&m_watcher, &QFileSystemWatcher::fileChanged, this, &QWebStaticFiles::fileChanged);
+}
+
+QWebStaticFiles::~QWebStaticFiles() {
+
+}
+
+void QWebStaticFiles::setCompression(const QWebCompression::Settings &settings) {
+    QMutexLocker locker(&m_lock);
+
+    m_compression = settings;
+    m_cache.clear();
+}
+
+QString QWebStaticFiles::normalize(const QString &path) {
+    if (path.contains('\\') || path.contains(QChar(0))) {
+        return QString();
+    }
+
+    QStringList levels;
+    for (const QString &level : path.split('/', QString::SkipEmptyParts)) {
+        if (level == "..") {
+            return QString();
+        }
+
+        if (level != ".") {
+            levels += level;
+        }
+    }
+
+    // not null, the root itself is an empty path
+    const QString joined = levels.join('/');
+
+    return joined.isEmpty() ? QString("") : joined;
+}
+
+int QWebStaticFiles::parseRange(const QString &range, const qint64 size, qint64 *offset, qint64 *length) {
+    const QString trimmed = range.trimmed();
+    if (!trimmed.startsWith("bytes=") || trimmed.contains(',')) {
+        return 0;
+    }
+
+    const QString spec = trimmed.mid(6).trimmed();
+    const int dash = spec.indexOf('-');
+    if (dash < 0) {
+        return 0;
+    }
+
+    bool okStart = true, okEnd = true;
+    const QString startStr = spec.left(dash).trimmed();
+    const QString endStr = spec.mid(dash + 1).trimmed();
+
+    qint64 start = 0;
+    qint64 end = size - 1;
+
+    if (startStr.isEmpty()) {
+        // the last bytes
+        const qint64 suffix = endStr.toLongLong(&okEnd);
+        if (!okEnd || suffix < 0) {
+            return 0;
+        }
+        if (suffix == 0 || size == 0) {
+            return -1;
+        }
+
+        start = qMax<qint64>(0, size - suffix);
+    } else {
+        start = startStr.toLongLong(&okStart);
+        if (!endStr.isEmpty()) {
+            end = qMin(end, endStr.toLongLong(&okEnd));
+        }
+
+        if (!okStart || !okEnd || start < 0) {
+            return 0;
+        }
+        if (start >= size || end < start) {
+            return -1;
+        }
+    }
+
+    *offset = start;
+    *length = end - start + 1;
+
+    return 1;
+}
+
+bool QWebStaticFiles::find(const QString &key, File *out) {
+    {
+        QMutexLocker locker(&m_lock);
+
+        const File *cached = m_cache.object(key);
+        if (cached) {
+            *out = *cached;
+            return true;
+        }
+    }
+
+    if (m_root.isEmpty()) {
+        return false;
+    }
+
+    QFileInfo info(m_root + '/' + key);
+    if (info.isDir()) {
+        info = QFileInfo(info.filePath() + "/index.html");
+    }
+
+    if (!info.isFile()) {
+        return false;
+    }
+
+    // symbolic links may lead out of the root
+    const QString canonical = info.canonicalFilePath();
+    if (!canonical.startsWith(m_root + '/')) {
+        return false;
+    }
+
+    File file;
+    file.fileName = canonical;
+    file.mimeType = QMimeDatabase().mimeTypeForFile(info, QMimeDatabase::MatchExtension).name();
+    file.size = info.size();
+    file.lastModified = info.lastModified();
+    file.etag = QString("\"%1-%2\"").arg(file.size, 0, 16)
+            .arg(file.lastModified.toMSecsSinceEpoch(), 0, 16);
+
+    if (file.size <= MAX_CACHED_FILE_SIZE && file.size < m_cache.maxCost()) {
+        QFile in(canonical);
+
+        if (in.open(QIODevice::ReadOnly)) {
+            const QByteArray data = in.readAll();
+
+            // changed while reading, serve it but do not keep it
+            if (data.size() == file.size) {
+                file.data = data;
+                encode(&file);
+
+                {
+                    QMutexLocker locker(&m_lock);
+                    m_cache.insert(key, new File(file), file.cost());
+                }
+
+                QMetaObject::invokeMethod(this, "watch", Qt::QueuedConnection,
+                                          Q_ARG(QString, canonical), Q_ARG(QString, key));
+
+                if (file.gzipModified.isValid()) {
+                    QMetaObject::invokeMethod(this, "watch", Qt::QueuedConnection,
+                                              Q_ARG(QString, canonical + ".gz"), Q_ARG(QString, key));
+                }
+            }
+        }
+    }
+
+    *out = file;
+    return true;
+}
+
+void QWebStaticFiles::encode(File *file) const {
+    if (m_compression.precompressed) {
+        const QFileInfo gzipped(file->fileName + ".gz");
+
+        if (gzipped.isFile() && gzipped.size() <= MAX_CACHED_FILE_SIZE) {
+            QFile in(gzipped.filePath());
+
+            if (in.open(QIODevice::ReadOnly)) {
+                file->gzip = in.readAll();
+                file->gzipModified = gzipped.lastModified();
+            }
+        }
+    }
+
+    // the same rules QWebResponse applies when writing
+    if (m_compression.level <= 0 || file->data.size() < m_compression.minSize
+            || !QWebCompression::isCompressible(file->mimeType, m_compression.types)) {
+        return;
+    }
+
+    if (file->gzip.isNull()) {
+        const QByteArray gzip = QWebCompression::compress(file->data, QWebCompression::GZIP, m_compression.level);
+        if (!gzip.isEmpty() && gzip.size() < file->data.size()) {
+            file->gzip = gzip;
+        }
+    }
+
+    const QByteArray deflate = QWebCompression::compress(file->data, QWebCompression::DEFLATE, m_compression.level);
+    if (!deflate.isEmpty() && deflate.size() < file->data.size()) {
+        file->deflate = deflate;
+    }
+}
+
+void QWebStaticFiles::watch(const QString &fileName, const QString &key) {
+    if (!m_watched.contains(fileName, key)) {
+        m_watched.insert(fileName, key);
+        m_watcher.addPath(fileName);
+    }
+
+    // the file may have changed before it was watched
+    QDateTime modified;
+    {
+        QMutexLocker locker(&m_lock);
+        const File *cached = m_cache.object(key);
+        if (!cached) {
+            return;
+        }
+
+        modified = fileName == cached->fileName ? cached->lastModified : cached->gzipModified;
+    }
+
+    if (QFileInfo(fileName).lastModified() != modified) {
+        fileChanged(fileName);
+    }
+}
+
+void QWebStaticFiles::fileChanged(const QString &fileName) {
+    {
+        QMutexLocker locker(&m_lock);
+        for (const QString &key : m_watched.values(fileName)) {
+            m_cache.remove(key);
+        }
+    }
+
+    m_watched.remove(fileName);
+    m_watcher.removePath(fileName);
+}
+
+void QWebStaticFiles::setNotFound(const QWebService::RouteFunction &func) {
+    m_404 = func ? func : QWebRouter::DEFAULT_404;
+}
+
+void QWebStaticFiles::writeCached(const File &file, const QSharedPointer<QWebRequest> &req,
+                                  const QSharedPointer<QWebResponse> &resp) const {
+    // the encodings were made when the file was read
+    resp->m_compression = nullptr;
+
+    if (file.gzip.isNull() && file.deflate.isNull()) {
+        resp->writeBytes(file.data, file.mimeType);
+        return;
+    }
+
+    QWebCompression::addVary(&resp->m_headers);
+
+    const QWebCompression::Encoding encoding =
+            QWebCompression::negotiate(req->httpRequest()->headers().value("accept-encoding"));
+
+    const QByteArray *body = &file.data;
+    if (encoding == QWebCompression::GZIP && !file.gzip.isNull()) {
+        body = &file.gzip;
+    } else if (encoding == QWebCompression::DEFLATE && !file.deflate.isNull()) {
+        body = &file.deflate;
+    }
+
+    if (body != &file.data) {
+        const QString name = QWebCompression::name(encoding);
+
+        // every encoding is its own representation with its own tag
+        QString etag = file.etag;
+        etag.insert(etag.size() - 1, '-' + name);
+
+        resp->setETag(etag);
+        resp->setHeader("Content-Encoding", name);
+    }
+
+    resp->writeBytes(*body, file.mimeType);
+}
+
+void QWebStaticFiles::handle(QSharedPointer<QWebRequest> req, QSharedPointer<QWebResponse> resp) {
+    const QString key = normalize(req->path().mid(m_prefix.size()));
+
+    File file;
+    if (key.isNull() || !find(key, &file)) {
+        m_404(req, resp);
+        return;
+    }
+
+    resp->setETag(file.etag);
+    resp->setLastModified(file.lastModified);
+    resp->setHeader("Accept-Ranges", "bytes");
+
+    const QHash<QString, QString> &headers = req->httpRequest()->headers();
+    const QString range = headers.value("range");
+    const QString ifRange = headers.value("if-range");
+
+    qint64 offset = 0;
+    qint64 length = file.size;
+    int ranged = 0;
+
+    // a range of an older version would be mixed with the new one
+    if (!range.isEmpty() && (ifRange.isEmpty() || ifRange == file.etag)) {
+        ranged = parseRange(range, file.size, &offset, &length);
+    }
+
+    if (ranged < 0) {
+        resp->setStatusCode(QWebResponse::StatusCode::STATUS_REQUESTED_RANGE_NOT_SATISFIABLE);
+        resp->setHeader("Content-Range", QString("bytes */%1").arg(file.size));
+        resp->writeText("416 Requested Range Not Satisfiable");
+        return;
+    }
+
+    if (ranged > 0) {
+        resp->setStatusCode(QWebResponse::StatusCode::STATUS_PARTIAL_CONTENT);
+        resp->setHeader("Content-Range", QString("bytes %1-%2/%3")
+                        .arg(offset).arg(offset + length - 1).arg(file.size));
+    }
+
+    if (!file.data.isNull() && ranged > 0) {
+        resp->writeBytes(file.data.mid(int(offset), int(length)), file.mimeType);
+    } else if (!file.data.isNull()) {
+        writeCached(file, req, resp);
+    } else if (ranged > 0) {
+        resp->writeFile(file.fileName, file.mimeType, offset, length);
+    } else {
+        resp->writeFile(file.fileName, file.mimeType);
+    }
+}
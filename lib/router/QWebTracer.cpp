@@ -0,0 +1,242 @@
+/*
+ * Copyright 2014 Kevin Brightwell <kevin.brightwell2@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "router/QWebTracer.h"
+
+#include "router/QWebJsonWriter.h"
+#include "router/QWebRouter.h"
+
+#include <QDebug>
+#include <QMutexLocker>
+#include <QThread>
+
+//!< Bytes of events buffered before they are written out
+static const int BATCH_SIZE = 64 * 1024;
+
+/**
+ * Runs QWebTracer::run(), only QWebTracer starts it.
+ */
+class QWebTracer_Writer : public QThread {
+
+public:
+
+    explicit QWebTracer_Writer(QWebTracer *tracer)
+        : m_tracer(tracer) {
+
+    }
+
+protected:
+
+    virtual
+    void run() {
+        m_tracer->run();
+    }
+
+private:
+
+    QWebTracer * const m_tracer;
+};
+
+QWebTracer::QWebTracer(const Settings &settings)
+    : m_settings(settings),
+      m_clock(),
+      m_nextId(1),
+      m_lock(),
+      m_buffer(),
+      m_empty(true),
+      m_file(settings.fileName),
+      m_wake(),
+      m_stopping(false),
+      m_writer(nullptr) {
+
+    m_clock.start();
+
+    if (m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        m_file.write("[\n");
+    } else {
+        qWarning() << "QWebTracer: Could not open" << settings.fileName << ":" << m_file.errorString();
+    }
+
+    m_writer = new QWebTracer_Writer(this);
+    m_writer->start(QThread::LowPriority);
+}
+
+QWebTracer::~QWebTracer() {
+    {
+        QMutexLocker locker(&m_lock);
+        m_stopping = true;
+        m_wake.wakeAll();
+    }
+
+    // the writer drains the buffer before it returns
+    m_writer->wait();
+    delete m_writer;
+
+    m_file.write("\n]\n");
+}
+
+void QWebTracer::finish(const QWebTrace &trace, const int status) {
+    const QByteArray out = events(trace, status, m_nextId.fetchAndAddRelaxed(1));
+    if (out.isEmpty()) {
+        // nothing was recorded, a lone separator would break the array
+        return;
+    }
+
+    QMutexLocker locker(&m_lock);
+
+    if (!m_empty) {
+        m_buffer += ",\n";
+    }
+
+    m_empty = false;
+    m_buffer += out;
+
+    if (m_buffer.size() >= BATCH_SIZE) {
+        m_wake.wakeAll();
+    }
+}
+
+void QWebTracer::run() {
+    QMutexLocker locker(&m_lock);
+
+    while (!m_stopping) {
+        locker.unlock();
+        drain();
+        locker.relock();
+
+        if (!m_stopping && m_buffer.size() < BATCH_SIZE) {
+            m_wake.wait(&m_lock, m_settings.flushInterval);
+        }
+    }
+
+    locker.unlock();
+
+    // everything finished before the tracer was deleted
+    drain();
+}
+
+void QWebTracer::drain() {
+    QByteArray batch;
+    {
+        QMutexLocker locker(&m_lock);
+        qSwap(batch, m_buffer);
+    }
+
+    if (batch.isEmpty()) {
+        return;
+    }
+
+    // a single writer, so batches land in the order they were buffered
+    m_file.write(batch);
+    m_file.flush();
+}
+
+/**
+ * Writes a complete event from `begin` to `end` nanoseconds, in microseconds
+ * as the format expects.
+ */
+static
+void writeEvent(QWebJsonWriter &json, const QString &name, const qint64 begin, const qint64 end,
+                const quint64 id) {
+    json.key("name").value(name)
+        .key("cat").value("qwebservice")
+        .key("ph").value("X")
+        .key("ts").value(begin / 1000.0)
+        .key("dur").value(qMax<qint64>(0, end - begin) / 1000.0)
+        .key("pid").value(1)
+        .key("tid").value(qint64(id));
+}
+
+QByteArray QWebTracer::events(const QWebTrace &trace, const int status, const quint64 id) {
+    qint64 begin = -1;
+    qint64 end = -1;
+
+    for (int i = 0; i < QWebTrace::PHASE_COUNT; ++i) {
+        const QWebTrace::Phase phase = static_cast<QWebTrace::Phase>(i);
+
+        if (trace.begin(phase) >= 0) {
+            begin = begin < 0 ? trace.begin(phase) : qMin(begin, trace.begin(phase));
+            end = qMax(end, trace.end(phase));
+        }
+    }
+
+    if (begin < 0) {
+        return QByteArray();
+    }
+
+    const QString method = QWebRouter::methodName(static_cast<QWebService::HttpMethod>(trace.method));
+
+    QWebJsonWriter json;
+
+    // the request first, so phases nest below it
+    json.beginObject();
+    writeEvent(json, method + ' ' + (trace.route.isEmpty() ? QString("<unmatched>") : trace.route),
+               begin, end, id);
+    json.key("args").beginObject()
+        .field("path", trace.path)
+        .field("status", status)
+        .endObject();
+    json.endObject();
+
+    QByteArray out = json.data();
+
+    for (int i = 0; i < QWebTrace::PHASE_COUNT; ++i) {
+        const QWebTrace::Phase phase = static_cast<QWebTrace::Phase>(i);
+        if (trace.begin(phase) < 0) {
+            continue;
+        }
+
+        QWebJsonWriter event;
+        event.beginObject();
+        writeEvent(event, QWebTrace::name(phase), trace.begin(phase), trace.end(phase), id);
+        event.endObject();
+
+        out += ",\n";
+        out += event.data();
+    }
+
+    return out;
+}
+
+QWebTrace::QWebTrace(const QWebTracer::Ptr &tracer)
+    : method(-1),
+      route(),
+      path(),
+      m_tracer(tracer) {
+
+    for (int i = 0; i < PHASE_COUNT; ++i) {
+        m_begin[i] = -1;
+        m_end[i] = -1;
+    }
+}
+
+const char *QWebTrace::name(const Phase phase) {
+    switch (phase) {
+    case ROUTE: return "route";
+    case BODY: return "body";
+    case HANDLER: return "handler";
+    case WAIT: return "wait";
+    case SERIALIZE: return "serialize";
+    case WRITE: return "write";
+    default: return "unknown";
+    }
+}
@@ -0,0 +1,111 @@
+#include "catch/catch.hpp"
+
+#include "QWebService.h"
+#include "router/QWebAccessLog.h"
+
+#include <QFile>
+#include <QScopedPointer>
+#include <QTemporaryDir>
+
+/**
+ * A GET of `/users/42` that took 1.5 ms.
+ */
+static
+QWebAccessLog::Record userRecord() {
+    QWebAccessLog::Record record;
+    record.time = 0;
+    record.method = QWebService::HttpMethod::HTTP_GET;
+    record.route = "/users/:id";
+    record.path = "/users/42";
+    record.peer = "127.0.0.1";
+    record.status = 200;
+    record.bytes = 512;
+    record.latency = 1500000;
+
+    return record;
+}
+
+SCENARIO( "Records are formatted by pattern", "[QWebAccessLog]" ) {
+
+    GIVEN( "A record" ) {
+        const QWebAccessLog::Record record = userRecord();
+
+        THEN( "The default format has every field" ) {
+            REQUIRE(QWebAccessLog::format(QWebAccessLog::DEFAULT_FORMAT, record)
+                    == "1970-01-01T00:00:00.000Z 127.0.0.1 GET /users/:id /users/42 200 512 1500");
+        }
+
+        THEN( "Missing values are written as a dash" ) {
+            QWebAccessLog::Record unmatched = record;
+            unmatched.route.clear();
+
+            REQUIRE(QWebAccessLog::format("%r %s %% %x", unmatched) == "- 200 % %x");
+        }
+
+        THEN( "Spaces and line breaks in the path are encoded" ) {
+            QWebAccessLog::Record forged = record;
+            forged.path = "/a b\n1970-01-01T00:00:00.000Z";
+
+            REQUIRE(QWebAccessLog::format("%U", forged) == "/a%20b%0A1970-01-01T00:00:00.000Z");
+        }
+
+        THEN( "The JSON format writes an object" ) {
+            REQUIRE(QWebAccessLog::format(QWebAccessLog::JSON_FORMAT, record)
+                    == "{\"time\":\"1970-01-01T00:00:00.000Z\",\"peer\":\"127.0.0.1\",\"method\":\"GET\","
+                       "\"route\":\"/users/:id\",\"path\":\"/users/42\",\"status\":200,\"bytes\":512,"
+                       "\"latencyUs\":1500}");
+        }
+    }
+}
+
+SCENARIO( "Records are written by a background thread", "[QWebAccessLog]" ) {
+
+    GIVEN( "A log file" ) {
+        QTemporaryDir dir;
+        REQUIRE(dir.isValid());
+
+        QWebAccessLog::Settings settings;
+        settings.fileName = dir.path() + "/access.log";
+        settings.format = "%m %U %s";
+
+        WHEN( "Records are appended and the log is deleted" ) {
+            QScopedPointer<QWebAccessLog> log(new QWebAccessLog(settings));
+            REQUIRE(log->needsPath());
+
+            for (int i = 0; i < 3; ++i) {
+                REQUIRE(log->append(userRecord()));
+            }
+
+            log.reset();
+
+            THEN( "Every record was written" ) {
+                QFile file(settings.fileName);
+                REQUIRE(file.open(QIODevice::ReadOnly));
+                REQUIRE(file.readAll() == "GET /users/42 200\nGET /users/42 200\nGET /users/42 200\n");
+            }
+        }
+
+        WHEN( "More records are appended than the buffer holds" ) {
+            settings.capacity = 2;
+            settings.flushInterval = 60000;
+
+            QScopedPointer<QWebAccessLog> log(new QWebAccessLog(settings));
+
+            for (int i = 0; i < 100; ++i) {
+                log->append(userRecord());
+            }
+
+            const quint64 dropped = log->dropped();
+            log.reset();
+
+            THEN( "Records are dropped instead of waiting" ) {
+                QFile file(settings.fileName);
+                REQUIRE(file.open(QIODevice::ReadOnly));
+
+                const int written = file.readAll().count('\n');
+                REQUIRE(dropped > 0);
+                REQUIRE(written + dropped == 100);
+            }
+        }
+    }
+}
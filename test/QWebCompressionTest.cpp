@@ -0,0 +1,82 @@
+#include "catch/catch.hpp"
+
+#include "router/QWebCompression.h"
+
+#include <QtEndian>
+
+SCENARIO( "The encoding is picked from Accept-Encoding", "[QWebCompression]" ) {
+
+    GIVEN( "Accept-Encoding headers" ) {
+
+        THEN( "gzip is preferred unless weighted lower" ) {
+            REQUIRE(QWebCompression::negotiate("") == QWebCompression::IDENTITY);
+            REQUIRE(QWebCompression::negotiate("br") == QWebCompression::IDENTITY);
+            REQUIRE(QWebCompression::negotiate("deflate, gzip") == QWebCompression::GZIP);
+            REQUIRE(QWebCompression::negotiate("GZIP;q=0.5, deflate") == QWebCompression::DEFLATE);
+            REQUIRE(QWebCompression::negotiate("gzip;q=0, deflate;q=0") == QWebCompression::IDENTITY);
+            REQUIRE(QWebCompression::negotiate("*") == QWebCompression::GZIP);
+            REQUIRE(QWebCompression::negotiate("gzip;q=0, *") == QWebCompression::DEFLATE);
+            REQUIRE(QWebCompression::negotiate("*, gzip;q=0, deflate;q=0") == QWebCompression::IDENTITY);
+            REQUIRE(QWebCompression::negotiate("deflate, *;q=0.5") == QWebCompression::DEFLATE);
+            REQUIRE(QWebCompression::negotiate("gzip; q = 0.5, deflate") == QWebCompression::DEFLATE);
+            REQUIRE(QWebCompression::negotiate("gzip ; Q=0 , deflate;q=0.2") == QWebCompression::DEFLATE);
+        }
+    }
+
+    GIVEN( "The default content types" ) {
+        const QStringList types = QWebCompression::defaultTypes();
+
+        THEN( "Text is compressed, images are not" ) {
+            REQUIRE(QWebCompression::isCompressible("text/html; charset=utf-8", types));
+            REQUIRE(QWebCompression::isCompressible("application/json", types));
+            REQUIRE_FALSE(QWebCompression::isCompressible("image/png", types));
+            REQUIRE_FALSE(QWebCompression::isCompressible("", types));
+        }
+    }
+}
+
+SCENARIO( "Bodies are compressed in one pass", "[QWebCompression]" ) {
+
+    GIVEN( "A repetitive body" ) {
+        const QByteArray body = QByteArray("{\"value\":\"compress me\"},").repeated(200);
+
+        WHEN( "It is deflated" ) {
+            const QByteArray deflated = QWebCompression::compress(body, QWebCompression::DEFLATE, 6);
+
+            THEN( "It is smaller and qUncompress reads it back" ) {
+                REQUIRE(!deflated.isEmpty());
+                REQUIRE(deflated.size() < body.size());
+
+                // qUncompress expects the length in front of the zlib stream
+                QByteArray framed(4, '\0');
+                qToBigEndian<quint32>(body.size(), reinterpret_cast<uchar *>(framed.data()));
+
+                REQUIRE(qUncompress(framed + deflated) == body);
+            }
+        }
+
+        WHEN( "It is gzipped" ) {
+            const QByteArray gzipped = QWebCompression::compress(body, QWebCompression::GZIP, 1);
+
+            THEN( "It has a gzip header" ) {
+                REQUIRE(gzipped.size() > 2);
+                REQUIRE(uchar(gzipped[0]) == 0x1f);
+                REQUIRE(uchar(gzipped[1]) == 0x8b);
+            }
+        }
+    }
+
+    GIVEN( "Vary headers" ) {
+        QHash<QString, QString> headers;
+
+        THEN( "Accept-Encoding is added once" ) {
+            QWebCompression::addVary(&headers);
+            QWebCompression::addVary(&headers);
+            REQUIRE(headers.value("Vary") == "Accept-Encoding");
+
+            headers["Vary"] = "Origin";
+            QWebCompression::addVary(&headers);
+            REQUIRE(headers.value("Vary") == "Origin, Accept-Encoding");
+        }
+    }
+}
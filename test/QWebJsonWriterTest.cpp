@@ -0,0 +1,80 @@
+#include "catch/catch.hpp"
+
+#include "router/QWebJsonWriter.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <limits>
+
+SCENARIO( "JSON is written straight to a buffer", "[QWebJsonWriter]" ) {
+
+    GIVEN( "A writer" ) {
+        QWebJsonWriter json;
+
+        WHEN( "An object with nested values is written" ) {
+            json.beginObject()
+                    .field("id", 42)
+                    .field("big", Q_INT64_C(-9007199254740993))
+                    .field("ratio", 0.5)
+                    .field("ok", true)
+                    .key("none").nullValue()
+                    .key("tags").beginArray().value("a").value("b").endArray()
+                    .key("empty").beginObject().endObject()
+                .endObject();
+
+            THEN( "It is compact JSON" ) {
+                REQUIRE(json.data() == "{\"id\":42,\"big\":-9007199254740993,\"ratio\":0.5,\"ok\":true,"
+                                       "\"none\":null,\"tags\":[\"a\",\"b\"],\"empty\":{}}");
+            }
+
+            THEN( "QJsonDocument reads the same values" ) {
+                const QJsonObject obj = QJsonDocument::fromJson(json.data()).object();
+                REQUIRE(obj["id"].toInt() == 42);
+                REQUIRE(obj["ratio"].toDouble() == 0.5);
+                REQUIRE(obj["tags"].toArray().size() == 2);
+                REQUIRE(obj["none"].isNull());
+            }
+        }
+
+        WHEN( "Integers of every width are written" ) {
+            json.beginArray()
+                    .value(3u)
+                    .value(-4L)
+                    .value(5UL)
+                    .value(size_t(6))
+                    .value(Q_UINT64_C(18446744073709551615))
+                    .value(std::numeric_limits<qint64>::min())
+                .endArray();
+
+            THEN( "None of them is rounded or truncated" ) {
+                REQUIRE(json.data() == "[3,-4,5,6,18446744073709551615,-9223372036854775808]");
+            }
+        }
+
+        WHEN( "Doubles are written" ) {
+            json.beginArray().value(0.1).value(1.0 / 3).value(-2.5e-8).value(1e21).endArray();
+
+            THEN( "They are as short as they can be and read back the same" ) {
+                REQUIRE(json.data().startsWith("[0.1,"));
+
+                const QJsonArray array = QJsonDocument::fromJson(json.data()).array();
+                REQUIRE(array.at(0).toDouble() == 0.1);
+                REQUIRE(array.at(1).toDouble() == 1.0 / 3);
+                REQUIRE(array.at(2).toDouble() == -2.5e-8);
+                REQUIRE(array.at(3).toDouble() == 1e21);
+            }
+        }
+
+        WHEN( "Strings need escaping" ) {
+            const QString str = QString::fromUtf8("q\"b\\n\n\x01 \xc3\xa9 \xf0\x9f\x98\x80");
+            json.beginArray().value(str).endArray();
+
+            THEN( "They read back unchanged" ) {
+                REQUIRE(json.data().startsWith("[\"q\\\"b\\\\n\\n\\u0001 "));
+                REQUIRE(QJsonDocument::fromJson(json.data()).array().at(0).toString() == str);
+            }
+        }
+    }
+}
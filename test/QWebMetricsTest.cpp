@@ -0,0 +1,91 @@
+#include "catch/catch.hpp"
+
+#include "router/QWebMetrics.h"
+
+SCENARIO( "Latencies map to buckets about 19% apart", "[QWebMetrics]" ) {
+
+    GIVEN( "Latencies in microseconds" ) {
+
+        THEN( "Small values have a bucket each" ) {
+            REQUIRE(QWebMetrics::bucketOf(0) == 0);
+            REQUIRE(QWebMetrics::bucketOf(3) == 3);
+            REQUIRE(QWebMetrics::bucketLimit(3) == 4);
+        }
+
+        THEN( "Every value is below the limit of its bucket" ) {
+            for (quint64 usec = 0; usec < 100000; usec += 7) {
+                const int bucket = QWebMetrics::bucketOf(usec);
+
+                REQUIRE(usec < QWebMetrics::bucketLimit(bucket));
+                REQUIRE((bucket == 0 || usec >= QWebMetrics::bucketLimit(bucket - 1)));
+            }
+        }
+
+        THEN( "Huge values end up in the last bucket" ) {
+            REQUIRE(QWebMetrics::bucketOf(Q_UINT64_C(1) << 40) == QWebMetrics::BUCKET_COUNT - 1);
+            REQUIRE(QWebMetrics::bucketOf(~Q_UINT64_C(0)) == QWebMetrics::BUCKET_COUNT - 1);
+        }
+    }
+}
+
+SCENARIO( "Shards are summed when exporting", "[QWebMetrics]" ) {
+
+    GIVEN( "Routes counted by two shards" ) {
+        QWebMetrics metrics;
+        const int users = metrics.addRoute("GET", "/users/:id");
+        const int quoted = metrics.addRoute("POST", "/say/\"hi\"");
+        const int errors = metrics.addRoute("GET", "/errors");
+        metrics.addRoute("GET", "/never");
+
+        QWebMetrics::Shard *first = metrics.addShard();
+        QWebMetrics::Shard *second = metrics.addShard();
+
+        first->record(users, 200, 100, 50000);        // 50 us
+        second->record(users, 200, 20, 2000000);      // 2 ms
+        second->record(users, 404, 5, 1000);
+        first->record(errors, 413, 0, 1000);
+        second->record(errors, 504, 0, 1000);
+        second->record(errors, 299, 0, 1000);
+        first->record(quoted, 500, 0, 1000);
+        second->record(quoted, 200, 0, 3600000000001LL);  // an hour and 1 ns
+
+        // ignored
+        first->record(-1, 200, 10, 10);
+        first->record(42, 200, 10, 10);
+
+        const QString text = QString::fromUtf8(metrics.toPrometheus());
+
+        THEN( "Status codes are counted per route" ) {
+            REQUIRE(text.contains("qwebservice_responses_total{method=\"GET\",route=\"/users/:id\",code=\"200\"} 2\n"));
+            REQUIRE(text.contains("qwebservice_responses_total{method=\"GET\",route=\"/users/:id\",code=\"404\"} 1\n"));
+            REQUIRE(text.contains("qwebservice_responses_total{method=\"GET\",route=\"/errors\",code=\"413\"} 1\n"));
+            REQUIRE(text.contains("qwebservice_responses_total{method=\"GET\",route=\"/errors\",code=\"504\"} 1\n"));
+            REQUIRE(text.contains("qwebservice_responses_total{method=\"GET\",route=\"/errors\",code=\"other\"} 1\n"));
+            REQUIRE(text.contains("qwebservice_response_bytes_total{method=\"GET\",route=\"/users/:id\"} 125\n"));
+        }
+
+        THEN( "The histogram is cumulative" ) {
+            REQUIRE(text.contains("qwebservice_request_duration_seconds_bucket{method=\"GET\",route=\"/users/:id\",le=\"0.0001\"} 2\n"));
+            REQUIRE(text.contains("qwebservice_request_duration_seconds_bucket{method=\"GET\",route=\"/users/:id\",le=\"0.001\"} 2\n"));
+            REQUIRE(text.contains("qwebservice_request_duration_seconds_bucket{method=\"GET\",route=\"/users/:id\",le=\"0.0025\"} 3\n"));
+            REQUIRE(text.contains("qwebservice_request_duration_seconds_bucket{method=\"GET\",route=\"/users/:id\",le=\"+Inf\"} 3\n"));
+            REQUIRE(text.contains("qwebservice_request_duration_seconds_count{method=\"GET\",route=\"/users/:id\"} 3\n"));
+        }
+
+        THEN( "The latency sum is in seconds" ) {
+            REQUIRE(text.contains("qwebservice_request_duration_seconds_sum{method=\"GET\",route=\"/users/:id\"} 0.002051000\n"));
+        }
+
+        THEN( "Label values are escaped" ) {
+            REQUIRE(text.contains("route=\"/say/\\\"hi\\\"\",code=\"500\"} 1\n"));
+        }
+
+        THEN( "Long sums are not rounded to 6 digits" ) {
+            REQUIRE(text.contains("qwebservice_request_duration_seconds_sum{method=\"POST\",route=\"/say/\\\"hi\\\"\"} 3600.000001001\n"));
+        }
+
+        THEN( "Routes without responses are left out" ) {
+            REQUIRE_FALSE(text.contains("/never"));
+        }
+    }
+}
@@ -0,0 +1,95 @@
+#include "catch/catch.hpp"
+
+#include "router/QWebMultipartParser.h"
+
+#include <QByteArray>
+#include <QList>
+
+/**
+ * Collects everything a parser reports.
+ */
+class PartCollector {
+public:
+
+    explicit PartCollector(QWebMultipartParser *parser)
+        : finished(false), failed(false) {
+
+        QObject::connect(parser, &QWebMultipartParser::partBegin, [this](const QWebMultipartParser::Part &part) {
+            parts += part;
+            contents += QByteArray();
+        });
+        QObject::connect(parser, &QWebMultipartParser::partData, [this](const QByteArray &chunk) {
+            contents.last() += chunk;
+        });
+        QObject::connect(parser, &QWebMultipartParser::finished, [this]() { finished = true; });
+        QObject::connect(parser, &QWebMultipartParser::error, [this]() { failed = true; });
+    }
+
+    QList<QWebMultipartParser::Part> parts;
+    QList<QByteArray> contents;
+    bool finished;
+    bool failed;
+};
+
+SCENARIO( "Multipart bodies are parsed incrementally", "[QWebMultipartParser]" ) {
+
+    const QByteArray body =
+            "preamble\r\n"
+            "--XyZ\r\n"
+            "Content-Disposition: form-data; name=\"title\"\r\n"
+            "\r\n"
+            "Hello\r\n"
+            "--XyZ\r\n"
+            "Content-Disposition: form-data; name=\"upload\"; filename=\"a.bin\"\r\n"
+            "Content-Type: application/octet-stream\r\n"
+            "\r\n"
+            "\r\n--Xy almost a boundary\r\n"
+            "--XyZ--\r\n"
+            "epilogue";
+
+    GIVEN( "The boundary from a Content-Type header" ) {
+        REQUIRE(QWebMultipartParser::boundaryFrom("multipart/form-data; boundary=XyZ") == "XyZ");
+        REQUIRE(QWebMultipartParser::boundaryFrom("multipart/form-data; boundary=\"XyZ\"") == "XyZ");
+        REQUIRE(QWebMultipartParser::boundaryFrom("text/plain").isEmpty());
+    }
+
+    GIVEN( "The body fed in chunks of 1, 3, 7 and 4096 bytes" ) {
+
+        for (const int chunkSize : {1, 3, 7, 4096}) {
+            QWebMultipartParser parser("XyZ");
+            PartCollector collector(&parser);
+
+            for (int i = 0; i < body.size(); i += chunkSize) {
+                parser.feed(body.mid(i, chunkSize));
+            }
+            parser.end();
+
+            // both parts are reported the same for every chunk size
+            REQUIRE(collector.finished);
+            REQUIRE_FALSE(collector.failed);
+            REQUIRE(collector.parts.size() == 2);
+
+            REQUIRE(collector.parts[0].name == "title");
+            REQUIRE(collector.parts[0].fileName.isEmpty());
+            REQUIRE(collector.contents[0] == "Hello");
+
+            REQUIRE(collector.parts[1].name == "upload");
+            REQUIRE(collector.parts[1].fileName == "a.bin");
+            REQUIRE(collector.parts[1].contentType == "application/octet-stream");
+            REQUIRE(collector.contents[1] == "\r\n--Xy almost a boundary");
+        }
+    }
+
+    GIVEN( "A body without its closing boundary" ) {
+        QWebMultipartParser parser("XyZ");
+        PartCollector collector(&parser);
+
+        parser.feed(body.left(body.indexOf("--XyZ--")));
+        parser.end();
+
+        THEN( "An error is reported" ) {
+            REQUIRE_FALSE(collector.finished);
+            REQUIRE(collector.failed);
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#include "catch/catch.hpp"
+
+#include "router/QWebRequest.h"
+#include "router/QWebRoute.h"
+
+#include <QHash>
+#include <QStringList>
+
+SCENARIO( "Query strings and form bodies are parsed", "[QWebRequest]" ) {
+
+    typedef QHash<QString, QString> Params;
+
+    GIVEN( "Simple pairs 'a=1&b=two'" ) {
+        Params params;
+        QWebRequest::parseQuery("a=1&b=two", &params);
+
+        REQUIRE(params == Params({{"a", "1"}, {"b", "two"}}));
+    }
+
+    GIVEN( "Encoded values 'q=hello+world&path=%2Fa%2Fb&utf=%C3%A9'" ) {
+        Params params;
+        QWebRequest::parseQuery("q=hello+world&path=%2Fa%2Fb&utf=%C3%A9", &params);
+
+        REQUIRE(params.value("q") == "hello world");
+        REQUIRE(params.value("path") == "/a/b");
+        REQUIRE(params.value("utf") == QString::fromUtf8("\xc3\xa9"));
+    }
+
+    GIVEN( "Keys without values 'a&b=&&c'" ) {
+        Params params;
+        QWebRequest::parseQuery("a&b=&&c", &params);
+
+        REQUIRE(params.size() == 3);
+        REQUIRE(params.contains("a"));
+        REQUIRE(params.value("a").isEmpty());
+        REQUIRE(params.value("b").isEmpty());
+        REQUIRE(params.contains("c"));
+    }
+
+    GIVEN( "Repeated keys 'id=1&id=2&id=3'" ) {
+        Params params;
+        QWebRequest::parseQuery("id=1&id=2&id=3", &params);
+
+        QStringList values = params.values("id");
+        values.sort();
+        REQUIRE(values == QStringList({"1", "2", "3"}));
+        REQUIRE(params.value("id") == "3");
+    }
+
+    GIVEN( "Malformed escapes 'a=100%&b=%zz'" ) {
+        Params params;
+        QWebRequest::parseQuery("a=100%&b=%zz", &params);
+
+        REQUIRE(params.value("a") == "100%");
+        REQUIRE(params.value("b") == "%zz");
+    }
+}
+
+SCENARIO( "Requests without a QHttpRequest", "[QWebRequest]" ) {
+
+    GIVEN( "A request built from a match only" ) {
+        QSharedPointer<QWebRequest> request = QWebRequest::create(nullptr, QWebRoute::Match());
+
+        THEN( "It has no multipart body" ) {
+            REQUIRE(request->multipart() == nullptr);
+        }
+    }
+}
@@ -0,0 +1,78 @@
+#include "catch/catch.hpp"
+
+#include "router/QWebResponseCache.h"
+
+#include <QThread>
+
+SCENARIO( "Responses are kept until they expire or are evicted", "[QWebResponseCache]" ) {
+
+    typedef QHttpResponse::StatusCode StatusCode;
+
+    GIVEN( "A cache of 1 KiB" ) {
+        QWebResponseCache cache(1024);
+
+        QWebResponseCache::Headers headers;
+        headers.insert("Content-Type", "text/plain");
+
+        WHEN( "A response is inserted" ) {
+            cache.insert("/a", StatusCode::STATUS_OK, headers, "hello", 60000);
+
+            THEN( "It is found with its headers" ) {
+                const QWebResponseCache::Entry *entry = cache.find("/a");
+                REQUIRE(entry);
+                REQUIRE(entry->status == StatusCode::STATUS_OK);
+                REQUIRE(entry->body == "hello");
+                REQUIRE(entry->headers.value("Content-Type") == "text/plain");
+                REQUIRE(cache.count() == 1);
+            }
+
+            THEN( "Other keys miss" ) {
+                REQUIRE_FALSE(cache.find("/b"));
+            }
+
+            THEN( "Inserting the key again replaces it" ) {
+                cache.insert("/a", StatusCode::STATUS_OK, headers, "bye", 60000);
+                REQUIRE(cache.count() == 1);
+                REQUIRE(cache.find("/a")->body == "bye");
+            }
+        }
+
+        WHEN( "A response outlives its TTL" ) {
+            cache.insert("/a", StatusCode::STATUS_OK, headers, "hello", 1);
+            QThread::msleep(5);
+
+            THEN( "It is dropped" ) {
+                REQUIRE_FALSE(cache.find("/a"));
+                REQUIRE(cache.count() == 0);
+                REQUIRE(cache.size() == 0);
+            }
+        }
+
+        WHEN( "More than the limit is inserted" ) {
+            const QByteArray body(300, 'x');
+            cache.insert("/a", StatusCode::STATUS_OK, headers, body, 60000);
+            cache.insert("/b", StatusCode::STATUS_OK, headers, body, 60000);
+
+            // "/a" is now the most recently used
+            REQUIRE(cache.find("/a"));
+
+            cache.insert("/c", StatusCode::STATUS_OK, headers, body, 60000);
+            cache.insert("/d", StatusCode::STATUS_OK, headers, body, 60000);
+
+            THEN( "The least recently used responses are evicted" ) {
+                REQUIRE(cache.size() <= 1024);
+                REQUIRE_FALSE(cache.find("/b"));
+                REQUIRE(cache.find("/d"));
+            }
+        }
+
+        WHEN( "A response is larger than the cache" ) {
+            cache.insert("/a", StatusCode::STATUS_OK, headers, QByteArray(2048, 'x'), 60000);
+
+            THEN( "It is not kept" ) {
+                REQUIRE_FALSE(cache.find("/a"));
+                REQUIRE(cache.count() == 0);
+            }
+        }
+    }
+}
@@ -0,0 +1,207 @@
+
+#include "catch/catch.hpp"
+
+#include "router/QWebRoute.h"
+#include "router/QWebRouteIndex.h"
+
+SCENARIO( "Index DSL and Regex routes", "[QWebRouteIndex]" ) {
+
+    typedef QWebRoute::ParsedRoute::Ptr ResultPtr;
+
+    const QWebRouteFactory factory;
+
+    GIVEN( "Static, named, wildcard and pattern routes" ) {
+        const QList<QWebRoute::Ptr> routes = {
+            factory.create("/users/list"),
+            factory.create("/users/:id"),
+            factory.create("/users/:id/posts/+"),
+            factory.create("/files/*"),
+            factory.create("/:name$one*|two+/info"),
+            factory.create("/a.b|c")
+        };
+
+        for (const QWebRoute::Ptr &ptr : routes) {
+            REQUIRE(ptr);
+        }
+
+        const QWebRouteIndex index(routes);
+        const QWebRouteIndex combined(routes, QWebRouteIndex::COMBINED_REGEX);
+
+        WHEN( "Matched against every route" ) {
+            const QStringList paths = {
+                "/users/list", "/users/kevin", "/users/kevin/posts/first",
+                "/files/", "/files/foo", "/oneA/info", "/two/info", "/twoB/info",
+                "/a.b", "/c", "/aab", "/users", "/users/kevin/posts", "/nothing/here",
+                QString::fromUtf8("/users/j\xc3\xb6rg"), QString::fromUtf8("/files/caf\xc3\xa9"),
+                QString::fromUtf8("/one\xc3\xa9/info")
+            };
+
+            THEN( "The results are the same as checking each route in order" ) {
+                for (const QString &path : paths) {
+                    int expected = -1;
+                    ResultPtr expectedResult;
+                    for (int i = 0; i < routes.size(); ++i) {
+                        expectedResult = routes[i]->checkPath(path);
+                        if (expectedResult) {
+                            expected = i;
+                            break;
+                        }
+                    }
+
+                    ResultPtr result;
+                    REQUIRE(index.match(path, &result) == expected);
+
+                    ResultPtr combinedResult;
+                    REQUIRE(combined.match(path, &combinedResult) == expected);
+
+                    if (expected >= 0) {
+                        REQUIRE(result);
+                        REQUIRE(result->urlParams() == expectedResult->urlParams());
+                        REQUIRE(result->splat() == expectedResult->splat());
+                        REQUIRE(result->groups() == expectedResult->groups());
+
+                        REQUIRE(combinedResult);
+                        REQUIRE(combinedResult->urlParams() == expectedResult->urlParams());
+                        REQUIRE(combinedResult->splat() == expectedResult->splat());
+                        REQUIRE(combinedResult->groups() == expectedResult->groups());
+                    }
+                }
+            }
+        }
+    }
+
+    GIVEN( "Routes with repeated wildcards '/a++/x', '/b**'" ) {
+        const QList<QWebRoute::Ptr> routes = {
+            factory.create("/a++/x"),
+            factory.create("/b**")
+        };
+
+        const QWebRouteIndex combined(routes, QWebRouteIndex::COMBINED_REGEX);
+
+        THEN( "The combined expression matches what each route does" ) {
+            const QStringList paths = { "/a/x", "/ab/x", "/abc/x", "/b", "/bc", "/bcd" };
+
+            for (const QString &path : paths) {
+                int expected = -1;
+                for (int i = 0; i < routes.size() && expected < 0; ++i) {
+                    if (routes[i]->checkPath(path)) {
+                        expected = i;
+                    }
+                }
+
+                ResultPtr result;
+                REQUIRE(combined.match(path, &result) == expected);
+            }
+
+            ResultPtr result;
+            REQUIRE(combined.match("/ab/x", &result) == 0);
+            REQUIRE(combined.match("/b", &result) == 1);
+        }
+    }
+
+    GIVEN( "Repeated wildcards in the level tree '/++', '/c++d', '/e**/f'" ) {
+        const QList<QWebRoute::Ptr> routes = {
+            factory.create("/c++d"),
+            factory.create("/e**/f"),
+            factory.create("/++")
+        };
+
+        const QWebRouteIndex index(routes);
+
+        THEN( "The tree matches what checkPath does" ) {
+            const QStringList paths = {
+                "/cd", "/cxd", "/cxyd", "/e/f", "/ex/f", "/x", "/xy", "/", "/x/y"
+            };
+
+            for (const QString &path : paths) {
+                int expected = -1;
+                ResultPtr expectedResult;
+                for (int i = 0; i < routes.size() && expected < 0; ++i) {
+                    expectedResult = routes[i]->checkPath(path);
+                    if (expectedResult) {
+                        expected = i;
+                    }
+                }
+
+                ResultPtr result;
+                REQUIRE(index.match(path, &result) == expected);
+
+                if (expected >= 0) {
+                    REQUIRE(result->splat() == expectedResult->splat());
+                }
+            }
+
+            ResultPtr result;
+            REQUIRE(index.match("/cxd", &result) == 0);
+            REQUIRE(index.match("/x", &result) == 2);
+        }
+    }
+
+    GIVEN( "Overlapping routes '/:name', '/foo'" ) {
+        const QList<QWebRoute::Ptr> routes = {
+            factory.create("/:name"),
+            factory.create("/foo")
+        };
+
+        const QWebRouteIndex index(routes);
+
+        WHEN( "Matched against /foo" ) {
+            ResultPtr result;
+            REQUIRE(index.match("/foo", &result) == 0);
+
+            auto params = QHash<QString, QString>({{"name", "foo"}});
+            REQUIRE(result->urlParams() == params);
+        }
+    }
+
+    GIVEN( "Static routes before and after a dynamic route '/health', '/:name', '/status'" ) {
+        const QList<QWebRoute::Ptr> routes = {
+            factory.create("/health"),
+            factory.create("/:name"),
+            factory.create("/status")
+        };
+
+        const QWebRouteIndex index(routes);
+
+        WHEN( "Matched against /health" ) {
+            ResultPtr result;
+            REQUIRE(index.match("/health", &result) == 0);
+            REQUIRE(result->groups() == QStringList({"/health"}));
+        }
+
+        THEN( "Matched against /status, which is shadowed by '/:name'" ) {
+            ResultPtr result;
+            REQUIRE(index.match("/status", &result) == 1);
+
+            auto params = QHash<QString, QString>({{"name", "status"}});
+            REQUIRE(result->urlParams() == params);
+        }
+    }
+
+    GIVEN( "A Regex route registered before a DSL route '/(foo|bar)', '/foo'" ) {
+        const QList<QWebRoute::Ptr> routes = {
+            factory.create("/baz"),
+            factory.createRegex("/(foo|bar)"),
+            factory.create("/foo")
+        };
+
+        const QWebRouteIndex index(routes);
+
+        WHEN( "Matched against /foo" ) {
+            ResultPtr result;
+            REQUIRE(index.match("/foo", &result) == 1);
+            REQUIRE(result->splat() == QStringList({"foo"}));
+        }
+
+        THEN( "Matched against /baz" ) {
+            ResultPtr result;
+            REQUIRE(index.match("/baz", &result) == 0);
+        }
+
+        THEN( "Matched against /qux (invalid)" ) {
+            ResultPtr result;
+            REQUIRE(index.match("/qux", &result) == -1);
+            REQUIRE_FALSE(result);
+        }
+    }
+}
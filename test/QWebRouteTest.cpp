@@ -152,6 +152,44 @@ SCENARIO( "Create and match DSL paths", "[QWebRoute]" ) {
         }
     }
     
+    GIVEN( "Multi-level, static DSL path '/one/two.json'" ) {
+        QWebRoute::Ptr ptr = factory.create("/one/two.json");
+        REQUIRE(ptr);
+        REQUIRE(ptr->isStatic());
+
+        WHEN( "Matched against /one/two.json" ) {
+            ResultPtr result = ptr->checkPath("/one/two.json");
+            REQUIRE(result);
+
+            REQUIRE(result->urlParams().size() == 0);
+            REQUIRE(result->splat().size() == 0);
+            REQUIRE(result->groups() == QStringList({"/one/two.json"}));
+        }
+
+        THEN( "Matched against /one/twoAjson (invalid)" ) {
+            ResultPtr result = ptr->checkPath("/one/twoAjson");
+            REQUIRE_FALSE(result);
+        }
+
+        THEN( "The route is kept as registered" ) {
+            REQUIRE(ptr->route() == "/one/two.json");
+            REQUIRE(ptr->staticPath() == "/one/two.json");
+
+            QWebRoute::Ptr repeated = factory.create("/one/two.json|two.json");
+            REQUIRE(repeated);
+            REQUIRE(repeated->isStatic());
+            REQUIRE(repeated->route() == "/one/two.json|two.json");
+            REQUIRE(repeated->staticPath() == "/one/two.json");
+            REQUIRE(repeated->checkPath("/one/two.json"));
+        }
+
+        THEN( "Non-literal paths are not static" ) {
+            REQUIRE_FALSE(factory.create("/one|two")->isStatic());
+            REQUIRE_FALSE(factory.create("/one/:two")->isStatic());
+            REQUIRE_FALSE(factory.create("/one*")->isStatic());
+        }
+    }
+
     GIVEN( "Single level, direct match with name '/:name$one'" ) {
         QWebRoute::Ptr ptr = factory.create("/:name$one");
         REQUIRE(ptr);
@@ -406,3 +444,40 @@ SCENARIO( "Create and match DSL paths", "[QWebRoute]" ) {
 
 
 }
+
+SCENARIO( "Match into a caller provided buffer", "[QWebRoute]" ) {
+
+    const QWebRouteFactory factory;
+
+    GIVEN( "A named level and a wildcard '/users/:id/files/*'" ) {
+        QWebRoute::Ptr ptr = factory.create("/users/:id/files/*");
+        REQUIRE(ptr);
+
+        QWebRoute::Match match;
+
+        WHEN( "Matched against /users/42/files/report" ) {
+            REQUIRE(ptr->checkPath("/users/42/files/report", &match));
+
+            THEN( "Captures are offsets into the path" ) {
+                REQUIRE(match.size() == 3);
+                REQUIRE(match.capturedRef(0) == QString("/users/42/files/report"));
+                REQUIRE(match.capturedRef(1) == QString("42"));
+                REQUIRE(match.name(1) == "id");
+                REQUIRE(match.name(2).isEmpty());
+
+                REQUIRE(match.urlParams() == QHash<QString, QString>({{"id", "42"}}));
+                REQUIRE(match.splat() == QStringList({"report"}));
+            }
+
+            AND_THEN( "The buffer is reused by the next match" ) {
+                REQUIRE(ptr->checkPath("/users/7/files/", &match));
+                REQUIRE(match.urlParams() == QHash<QString, QString>({{"id", "7"}}));
+                REQUIRE(match.splat() == QStringList({""}));
+            }
+        }
+
+        WHEN( "Matched against /users/42 (invalid)" ) {
+            REQUIRE_FALSE(ptr->checkPath("/users/42", &match));
+        }
+    }
+}
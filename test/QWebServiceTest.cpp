@@ -11,6 +11,14 @@
 #include <string>
 #include <QWebServiceConfig.h>
 #include <QTimer>
+#include <QThread>
+#include <QTemporaryFile>
+#include <QTemporaryDir>
+#include <QFile>
+#include <QSemaphore>
+#include <QTcpSocket>
+#include <QCoreApplication>
+#include <thread>
 #include "router/QWebRequest.h"
 #include "router/QWebResponse.h"
 
@@ -56,3 +64,876 @@ SCENARIO( "A simple service is configured and used", "[QWebService]" ) {
         }
     }
 }
+
+SCENARIO( "A service is served by worker threads", "[QWebService]" ) {
+
+    GIVEN( "A service with two workers" )
+    {
+        QNetworkAccessManager manager;
+
+        auto response = [](QSharedPointer<QWebRequest>, QSharedPointer<QWebResponse> resp)
+        {
+            resp->writeText(QThread::currentThread()->objectName());
+        };
+
+        QSharedPointer<QWebService> service = QSharedPointer<QWebService> (QWebServiceConfig()
+                .get("/thread", response)
+                .workerCount(2)
+                .build());
+
+        REQUIRE(service);
+
+        int starts = 0, stops = 0;
+        QObject::connect(service.data(), &QWebService::start, [&]() { ++starts; });
+        QObject::connect(service.data(), &QWebService::stop, [&]() { ++stops; });
+
+        REQUIRE(service->startService(QHostAddress::LocalHost, 8081));
+
+        WHEN( "We call the path thread" )
+        {
+            QNetworkReply* reply = manager.get(QNetworkRequest(QUrl("http://localhost:8081/thread")));
+
+            bool noTimeout = testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400);
+
+            REQUIRE(noTimeout);
+            REQUIRE(reply->readAll().startsWith("QWebWorker-"));
+        }
+
+        service->stopService();
+        service->stopService();
+
+        THEN( "start and stop fired once" )
+        {
+            REQUIRE(starts == 1);
+            REQUIRE(stops == 1);
+        }
+    }
+}
+
+SCENARIO( "SO_REUSEPORT workers share the port picked by the system", "[QWebService]" ) {
+
+    GIVEN( "A service with four SO_REUSEPORT workers started on port 0" )
+    {
+        QNetworkAccessManager manager;
+
+        auto response = [](QSharedPointer<QWebRequest>, QSharedPointer<QWebResponse> resp)
+        {
+            resp->writeText(QThread::currentThread()->objectName());
+        };
+
+        QSharedPointer<QWebService> service = QSharedPointer<QWebService> (QWebServiceConfig()
+                .get("/thread", response)
+                .workerCount(4)
+                .reusePort(true)
+                .build());
+
+        REQUIRE(service);
+        REQUIRE(service->serverPort() == 0);
+
+#if defined(Q_OS_LINUX)
+        REQUIRE(service->startService(QHostAddress::LocalHost, 0));
+
+        const quint16 port = service->serverPort();
+        REQUIRE(port != 0);
+
+        WHEN( "We call the path thread on the reported port" )
+        {
+            const QUrl url(QString("http://localhost:%1/thread").arg(port));
+
+            for (int i = 0; i < 8; ++i) {
+                QNetworkReply* reply = manager.get(QNetworkRequest(url));
+
+                bool noTimeout = testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400);
+
+                REQUIRE(noTimeout);
+                REQUIRE(reply->error() == QNetworkReply::NoError);
+                REQUIRE(reply->readAll().startsWith("QWebWorker-"));
+            }
+        }
+
+        service->stopService();
+#endif
+    }
+}
+
+SCENARIO( "Handlers answer asynchronously", "[QWebService]" ) {
+
+    GIVEN( "A service with a deferred and a never finished route" )
+    {
+        QNetworkAccessManager manager;
+
+        auto later = [](QSharedPointer<QWebRequest>, QSharedPointer<QWebResponse> resp)
+        {
+            resp->defer();
+
+            QTimer *timer = new QTimer;
+            timer->setSingleShot(true);
+            QObject::connect(timer, &QTimer::timeout, [resp, timer]() {
+                resp->writeText("later");
+                resp->finish();
+                timer->deleteLater();
+            });
+            timer->start(50);
+        };
+
+        auto never = [](QSharedPointer<QWebRequest>, QSharedPointer<QWebResponse> resp)
+        {
+            resp->defer();
+        };
+
+        QSharedPointer<QWebService> service = QSharedPointer<QWebService> (QWebServiceConfig()
+                .get("/later", later)
+                .get("/never", never)
+                .asyncTimeout(100)
+                .build());
+
+        REQUIRE(service);
+
+        service->startService(QHostAddress::LocalHost, 8082);
+
+        WHEN( "We call the deferred path" )
+        {
+            QNetworkReply* reply = manager.get(QNetworkRequest(QUrl("http://localhost:8082/later")));
+
+            bool noTimeout = testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400);
+
+            REQUIRE(noTimeout);
+            REQUIRE(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 200);
+            REQUIRE(reply->readAll() == "later");
+        }
+
+        WHEN( "We call the path that never finishes" )
+        {
+            QNetworkReply* reply = manager.get(QNetworkRequest(QUrl("http://localhost:8082/never")));
+
+            bool noTimeout = testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400);
+
+            REQUIRE(noTimeout);
+            REQUIRE(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 504);
+        }
+    }
+}
+
+SCENARIO( "Deferred responses without a timeout go with their connection", "[QWebService]" ) {
+
+    GIVEN( "A never finished route and no async timeout" )
+    {
+        QWeakPointer<QWebResponse> pending;
+
+        auto never = [&pending](QSharedPointer<QWebRequest>, QSharedPointer<QWebResponse> resp)
+        {
+            resp->defer();
+            pending = resp;
+        };
+
+        QSharedPointer<QWebService> service = QSharedPointer<QWebService> (QWebServiceConfig()
+                .get("/never", never)
+                .asyncTimeout(0)
+                .build());
+
+        REQUIRE(service->startService(QHostAddress::LocalHost, 8095));
+
+        WHEN( "The client leaves before it is answered" )
+        {
+            QTcpSocket socket;
+            socket.connectToHost(QHostAddress::LocalHost, 8095);
+            REQUIRE(socket.waitForConnected(400));
+
+            socket.write("GET /never HTTP/1.1\r\nHost: localhost\r\n\r\n");
+            REQUIRE(socket.waitForBytesWritten(400));
+
+            for (int i = 0; i < 40 && pending.isNull(); ++i) {
+                QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+            }
+            REQUIRE_FALSE(pending.isNull());
+
+            socket.disconnectFromHost();
+
+            for (int i = 0; i < 40 && !pending.isNull(); ++i) {
+                QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+                QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+            }
+
+            THEN( "The response is released" )
+            {
+                REQUIRE(pending.isNull());
+            }
+        }
+    }
+}
+
+SCENARIO( "Files are streamed in chunks", "[QWebService]" ) {
+
+    GIVEN( "A file larger than a chunk" )
+    {
+        QNetworkAccessManager manager;
+
+        QTemporaryFile file;
+        REQUIRE(file.open());
+
+        QByteArray contents;
+        for (int i = 0; contents.size() < 3 * QWebResponse::STREAM_CHUNK_SIZE + 17; ++i) {
+            contents += QByteArray::number(i) + ',';
+        }
+        file.write(contents);
+        file.flush();
+
+        const QString fileName = file.fileName();
+        auto download = [fileName](QSharedPointer<QWebRequest>, QSharedPointer<QWebResponse> resp)
+        {
+            resp->writeFile(fileName, "text/csv");
+        };
+
+        QSharedPointer<QWebService> service = QSharedPointer<QWebService> (QWebServiceConfig()
+                .get("/download", download)
+                .build());
+
+        service->startService(QHostAddress::LocalHost, 8083);
+
+        WHEN( "We download it" )
+        {
+            QNetworkReply* reply = manager.get(QNetworkRequest(QUrl("http://localhost:8083/download")));
+
+            bool noTimeout = testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 2000);
+
+            REQUIRE(noTimeout);
+            REQUIRE(reply->header(QNetworkRequest::ContentLengthHeader).toLongLong() == contents.size());
+            REQUIRE(reply->readAll() == contents);
+        }
+    }
+}
+
+SCENARIO( "Responses are streamed with chunked encoding", "[QWebService]" ) {
+
+    GIVEN( "A route producing ten lines" )
+    {
+        QNetworkAccessManager manager;
+
+        auto lines = [](QSharedPointer<QWebRequest>, QSharedPointer<QWebResponse> resp)
+        {
+            QSharedPointer<int> line(new int(0));
+
+            resp->writeStream([line]() -> QByteArray {
+                if (*line == 10) {
+                    return QByteArray();
+                }
+
+                return "line " + QByteArray::number((*line)++) + "\n";
+            }, "text/plain");
+        };
+
+        QSharedPointer<QWebService> service = QSharedPointer<QWebService> (QWebServiceConfig()
+                .get("/lines", lines)
+                .build());
+
+        service->startService(QHostAddress::LocalHost, 8084);
+
+        WHEN( "We call the path lines" )
+        {
+            QNetworkReply* reply = manager.get(QNetworkRequest(QUrl("http://localhost:8084/lines")));
+
+            bool noTimeout = testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400);
+
+            REQUIRE(noTimeout);
+            REQUIRE(reply->rawHeader("Transfer-Encoding") == "chunked");
+
+            const QByteArray body = reply->readAll();
+            REQUIRE(body.startsWith("line 0\n"));
+            REQUIRE(body.endsWith("line 9\n"));
+            REQUIRE(body.count('\n') == 10);
+        }
+    }
+}
+
+SCENARIO( "Chunks are pushed to a stream from another thread", "[QWebService]" ) {
+
+    GIVEN( "A route pushing ten lines through a queue of two" )
+    {
+        QNetworkAccessManager manager;
+
+        bool refused = false;
+
+        auto push = [&refused](QSharedPointer<QWebRequest>, QSharedPointer<QWebResponse> resp)
+        {
+            resp->beginStream("text/plain", 2);
+
+            // nothing is sent before the head, the third line does not fit
+            resp->write("line 0\n");
+            resp->write("line 1\n");
+            refused = !resp->write("line 2\n");
+
+            QSharedPointer<QSemaphore> room(new QSemaphore);
+            QObject::connect(resp.data(), &QWebResponse::writable, [room]() {
+                room->release();
+            });
+
+            std::thread([resp, room]() {
+                for (int line = 2; line < 10; ++line) {
+                    while (!resp->write("line " + QByteArray::number(line) + "\n")) {
+                        room->acquire();
+                    }
+                }
+
+                resp->end();
+            }).detach();
+        };
+
+        QSharedPointer<QWebService> service = QSharedPointer<QWebService> (QWebServiceConfig()
+                .get("/push", push)
+                .build());
+
+        service->startService(QHostAddress::LocalHost, 8094);
+
+        WHEN( "We call the path push" )
+        {
+            QNetworkReply* reply = manager.get(QNetworkRequest(QUrl("http://localhost:8094/push")));
+
+            bool noTimeout = testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 2000);
+
+            REQUIRE(noTimeout);
+            REQUIRE(refused);
+            REQUIRE(reply->rawHeader("Transfer-Encoding") == "chunked");
+
+            const QByteArray body = reply->readAll();
+            REQUIRE(body.startsWith("line 0\nline 1\nline 2\n"));
+            REQUIRE(body.endsWith("line 9\n"));
+            REQUIRE(body.count('\n') == 10);
+        }
+    }
+}
+
+SCENARIO( "Requests are rejected before their body is read", "[QWebService]" ) {
+
+    GIVEN( "A service with a limited upload route" )
+    {
+        QNetworkAccessManager manager;
+
+        auto echo = [](QSharedPointer<QWebRequest> req, QSharedPointer<QWebResponse> resp)
+        {
+            resp->writeText(req->body());
+        };
+
+        QSharedPointer<QWebService> service = QSharedPointer<QWebService> (QWebServiceConfig()
+                .post("/upload", echo).maxBodySize(16)
+                .build());
+
+        service->startService(QHostAddress::LocalHost, 8085);
+
+        QNetworkRequest request(QUrl("http://localhost:8085/upload"));
+        request.setHeader(QNetworkRequest::ContentTypeHeader, "text/plain");
+
+        WHEN( "A small body is posted" )
+        {
+            QNetworkReply* reply = manager.post(request, QByteArray("small"));
+
+            REQUIRE(testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400));
+            REQUIRE(reply->readAll() == "small");
+        }
+
+        WHEN( "A body over the limit is posted" )
+        {
+            QNetworkReply* reply = manager.post(request, QByteArray(1024, 'x'));
+
+            REQUIRE(testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400));
+            REQUIRE(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 413);
+        }
+
+        WHEN( "A chunked body goes over the limit" )
+        {
+            // no Content-Length, only the running count can catch it
+            QTcpSocket socket;
+            socket.connectToHost(QHostAddress::LocalHost, 8085);
+            REQUIRE(socket.waitForConnected(400));
+
+            socket.write("POST /upload HTTP/1.1\r\n"
+                         "Host: localhost\r\n"
+                         "Content-Type: text/plain\r\n"
+                         "Transfer-Encoding: chunked\r\n"
+                         "\r\n"
+                         "40\r\n" + QByteArray(64, 'x') + "\r\n");
+
+            // the rest of the body is never sent, the server has to give up on it
+            QByteArray answer;
+            while (socket.state() == QAbstractSocket::ConnectedState && socket.waitForReadyRead(400)) {
+                answer += socket.readAll();
+            }
+            answer += socket.readAll();
+
+            THEN( "It is answered with a 413 and the connection is closed" )
+            {
+                REQUIRE(answer.startsWith("HTTP/1.1 413"));
+                REQUIRE(answer.toLower().contains("connection: close"));
+                REQUIRE(socket.state() != QAbstractSocket::ConnectedState);
+            }
+        }
+
+        WHEN( "The route is called with the wrong method" )
+        {
+            QNetworkReply* reply = manager.get(request);
+
+            REQUIRE(testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400));
+            REQUIRE(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 405);
+            REQUIRE(reply->rawHeader("Allow") == "POST");
+        }
+    }
+}
+
+SCENARIO( "Request bodies are streamed to the handler", "[QWebService]" ) {
+
+    GIVEN( "A route that counts its body as it arrives" )
+    {
+        QNetworkAccessManager manager;
+
+        auto count = [](QSharedPointer<QWebRequest> req, QSharedPointer<QWebResponse> resp)
+        {
+            resp->defer();
+
+            QSharedPointer<qint64> received(new qint64(0));
+            QObject::connect(req.data(), &QWebRequest::bodyData, [received](const QByteArray &chunk) {
+                *received += chunk.size();
+            });
+            QObject::connect(req.data(), &QWebRequest::bodyEnd, [req, resp, received]() {
+                REQUIRE(req->rawBody().isEmpty());
+
+                resp->writeText(QString::number(*received));
+                resp->finish();
+            });
+        };
+
+        QSharedPointer<QWebService> service = QSharedPointer<QWebService> (QWebServiceConfig()
+                .post("/count", count).streamBody()
+                .build());
+
+        service->startService(QHostAddress::LocalHost, 8086);
+
+        WHEN( "A large body is posted" )
+        {
+            QNetworkRequest request(QUrl("http://localhost:8086/count"));
+            request.setHeader(QNetworkRequest::ContentTypeHeader, "application/octet-stream");
+
+            QNetworkReply* reply = manager.post(request, QByteArray(1024 * 1024, 'x'));
+
+            REQUIRE(testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 2000));
+            REQUIRE(reply->readAll() == "1048576");
+        }
+    }
+}
+
+SCENARIO( "Middleware runs before the handlers", "[QWebService]" ) {
+
+    GIVEN( "A global middleware and a route guarded by its own" )
+    {
+        QNetworkAccessManager manager;
+
+        auto hello = [](QSharedPointer<QWebRequest>, QSharedPointer<QWebResponse> resp)
+        {
+            resp->writeText("hello");
+        };
+
+        auto tag = [](const QSharedPointer<QWebRequest> &, const QSharedPointer<QWebResponse> &resp) {
+            resp->setHeader("X-Tag", "seen");
+            return true;
+        };
+
+        auto requireToken = [](const QSharedPointer<QWebRequest> &req, const QSharedPointer<QWebResponse> &resp) {
+            if (req->httpRequest()->headers().value("x-token") == "secret") {
+                return true;
+            }
+
+            resp->setStatusCode(QWebResponse::StatusCode::STATUS_UNAUTHORIZED);
+            resp->writeText("no token");
+            return false;
+        };
+
+        QSharedPointer<QWebService> service = QSharedPointer<QWebService> (QWebServiceConfig()
+                .get("/open", hello)
+                .get("/guarded", hello).middleware(requireToken)
+                .use(tag)
+                .build());
+
+        service->startService(QHostAddress::LocalHost, 8087);
+
+        WHEN( "The open route is called" )
+        {
+            QNetworkReply* reply = manager.get(QNetworkRequest(QUrl("http://localhost:8087/open")));
+
+            REQUIRE(testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400));
+            REQUIRE(reply->rawHeader("X-Tag") == "seen");
+            REQUIRE(reply->readAll() == "hello");
+        }
+
+        WHEN( "The guarded route is called without a token" )
+        {
+            QNetworkReply* reply = manager.get(QNetworkRequest(QUrl("http://localhost:8087/guarded")));
+
+            REQUIRE(testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400));
+            REQUIRE(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 401);
+            REQUIRE(reply->rawHeader("X-Tag") == "seen");
+        }
+
+        WHEN( "The guarded route is called with a token" )
+        {
+            QNetworkRequest request(QUrl("http://localhost:8087/guarded"));
+            request.setRawHeader("X-Token", "secret");
+            QNetworkReply* reply = manager.get(request);
+
+            REQUIRE(testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400));
+            REQUIRE(reply->readAll() == "hello");
+        }
+    }
+}
+
+SCENARIO( "Responses of cached routes are served from memory", "[QWebService]" ) {
+
+    GIVEN( "A route cached by its `page` parameter" )
+    {
+        QNetworkAccessManager manager;
+
+        int calls = 0;
+        auto counted = [&calls](QSharedPointer<QWebRequest> req, QSharedPointer<QWebResponse> resp)
+        {
+            ++calls;
+            resp->writeText(QString("page %1").arg(req->queryParams().value("page")));
+        };
+
+        auto session = [&calls](QSharedPointer<QWebRequest>, QSharedPointer<QWebResponse> resp)
+        {
+            ++calls;
+            resp->setHeader("Set-Cookie", QString("session=%1").arg(calls));
+            resp->writeText("welcome");
+        };
+
+        QSharedPointer<QWebService> service = QSharedPointer<QWebService> (QWebServiceConfig()
+                .get("/report", counted).cache(60000, QStringList() << "page")
+                .get("/session", session).cache(60000)
+                .responseCacheSize(1024 * 1024)
+                .build());
+
+        service->startService(QHostAddress::LocalHost, 8088);
+
+        WHEN( "The same page is requested twice" )
+        {
+            for (int i = 0; i < 2; ++i) {
+                QNetworkReply* reply = manager.get(QNetworkRequest(QUrl("http://localhost:8088/report?page=1&x=" + QString::number(i))));
+
+                REQUIRE(testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400));
+                REQUIRE(reply->readAll() == "page 1");
+                REQUIRE(reply->header(QNetworkRequest::ContentTypeHeader).toString().startsWith("text/plain"));
+            }
+
+            THEN( "The handler ran once" ) {
+                REQUIRE(calls == 1);
+            }
+        }
+
+        WHEN( "Another page is requested" )
+        {
+            for (const QString page : {"1", "2"}) {
+                QNetworkReply* reply = manager.get(QNetworkRequest(QUrl("http://localhost:8088/report?page=" + page)));
+
+                REQUIRE(testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400));
+                REQUIRE(reply->readAll() == "page " + page.toLatin1());
+            }
+
+            THEN( "Each page ran the handler" ) {
+                REQUIRE(calls == 2);
+            }
+        }
+
+        WHEN( "A response setting a cookie is requested twice" )
+        {
+            for (const QByteArray cookie : {"session=1", "session=2"}) {
+                QNetworkReply* reply = manager.get(QNetworkRequest(QUrl("http://localhost:8088/session")));
+
+                REQUIRE(testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400));
+                REQUIRE(reply->rawHeader("Set-Cookie") == cookie);
+            }
+
+            THEN( "It was not cached" ) {
+                REQUIRE(calls == 2);
+            }
+        }
+    }
+}
+
+SCENARIO( "Responses are compressed for clients that accept it", "[QWebService]" ) {
+
+    GIVEN( "A service compressing text of 64 bytes or more" )
+    {
+        QNetworkAccessManager manager;
+
+        const QString text = QString("compress me, ").repeated(20);
+        auto hello = [text](QSharedPointer<QWebRequest>, QSharedPointer<QWebResponse> resp)
+        {
+            resp->writeText(text);
+        };
+
+        QSharedPointer<QWebService> service = QSharedPointer<QWebService> (QWebServiceConfig()
+                .get("/text", hello)
+                .compression(6, 64)
+                .build());
+
+        service->startService(QHostAddress::LocalHost, 8089);
+
+        WHEN( "The client accepts gzip" )
+        {
+            // set by hand, QNetworkAccessManager leaves the body compressed then
+            QNetworkRequest request(QUrl("http://localhost:8089/text"));
+            request.setRawHeader("Accept-Encoding", "gzip");
+            QNetworkReply* reply = manager.get(request);
+
+            REQUIRE(testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400));
+
+            const QByteArray body = reply->readAll();
+            REQUIRE(reply->rawHeader("Content-Encoding") == "gzip");
+            REQUIRE(reply->rawHeader("Vary") == "Accept-Encoding");
+            REQUIRE(reply->header(QNetworkRequest::ContentLengthHeader).toInt() == body.size());
+            REQUIRE(body.size() < text.size());
+        }
+
+        WHEN( "The client does not accept compression" )
+        {
+            QNetworkRequest request(QUrl("http://localhost:8089/text"));
+            request.setRawHeader("Accept-Encoding", "identity");
+            QNetworkReply* reply = manager.get(request);
+
+            REQUIRE(testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400));
+            REQUIRE(reply->rawHeader("Content-Encoding").isEmpty());
+            REQUIRE(reply->readAll() == text.toLatin1());
+        }
+    }
+}
+
+SCENARIO( "Conditional requests are answered with 304", "[QWebService]" ) {
+
+    GIVEN( "A route with validators" )
+    {
+        QNetworkAccessManager manager;
+
+        auto hello = [](QSharedPointer<QWebRequest>, QSharedPointer<QWebResponse> resp)
+        {
+            resp->writeText("hello");
+        };
+
+        QTemporaryDir dir;
+        REQUIRE(dir.isValid());
+
+        QFile file(dir.path() + "/page.txt");
+        REQUIRE(file.open(QIODevice::WriteOnly));
+        file.write("a page of text");
+        file.close();
+
+        const QString fileName = file.fileName();
+        auto page = [fileName](QSharedPointer<QWebRequest>, QSharedPointer<QWebResponse> resp)
+        {
+            resp->writeFile(fileName, "text/plain");
+        };
+
+        QSharedPointer<QWebService> service = QSharedPointer<QWebService> (QWebServiceConfig()
+                .get("/hello", hello).conditional()
+                .get("/page", page).conditional()
+                .build());
+
+        service->startService(QHostAddress::LocalHost, 8090);
+
+        QNetworkReply* first = manager.get(QNetworkRequest(QUrl("http://localhost:8090/hello")));
+        REQUIRE(testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400));
+
+        const QByteArray etag = first->rawHeader("ETag");
+        REQUIRE(etag.startsWith('"'));
+
+        WHEN( "The tag is sent back" )
+        {
+            QNetworkRequest request(QUrl("http://localhost:8090/hello"));
+            request.setRawHeader("If-None-Match", etag);
+            QNetworkReply* reply = manager.get(request);
+
+            REQUIRE(testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400));
+            REQUIRE(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304);
+            REQUIRE(reply->rawHeader("ETag") == etag);
+            REQUIRE(reply->readAll().isEmpty());
+
+            THEN( "It carries the length of the representation, not of its empty body" )
+            {
+                REQUIRE(reply->rawHeader("Content-Length") == "5");
+                REQUIRE_FALSE(reply->hasRawHeader("Transfer-Encoding"));
+                REQUIRE_FALSE(reply->hasRawHeader("Content-Type"));
+            }
+        }
+
+        WHEN( "The tag of a file is sent back" )
+        {
+            QNetworkReply* full = manager.get(QNetworkRequest(QUrl("http://localhost:8090/page")));
+            REQUIRE(testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400));
+
+            QNetworkRequest request(QUrl("http://localhost:8090/page"));
+            request.setRawHeader("If-None-Match", full->rawHeader("ETag"));
+            QNetworkReply* reply = manager.get(request);
+
+            REQUIRE(testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400));
+            REQUIRE(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304);
+            REQUIRE(reply->rawHeader("Content-Length") == "14");
+            REQUIRE_FALSE(reply->hasRawHeader("Transfer-Encoding"));
+        }
+
+        WHEN( "Another tag is sent" )
+        {
+            QNetworkRequest request(QUrl("http://localhost:8090/hello"));
+            request.setRawHeader("If-None-Match", "\"other\"");
+            QNetworkReply* reply = manager.get(request);
+
+            REQUIRE(testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400));
+            REQUIRE(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 200);
+            REQUIRE(reply->readAll() == "hello");
+        }
+    }
+}
+
+SCENARIO( "A directory is served", "[QWebService]" ) {
+
+    GIVEN( "A directory with a file" )
+    {
+        QNetworkAccessManager manager;
+
+        QTemporaryDir dir;
+        REQUIRE(dir.isValid());
+
+        QFile file(dir.path() + "/hello.txt");
+        REQUIRE(file.open(QIODevice::WriteOnly));
+        file.write("hello static");
+        file.close();
+
+        QSharedPointer<QWebService> service = QSharedPointer<QWebService> (QWebServiceConfig()
+                .serveDirectory("/static", dir.path())
+                .fourohfour([](QSharedPointer<QWebRequest>, QSharedPointer<QWebResponse> resp) {
+                    resp->setStatusCode(QWebResponse::StatusCode::STATUS_NOT_FOUND);
+                    resp->writeText("custom 404");
+                })
+                .build());
+
+        service->startService(QHostAddress::LocalHost, 8091);
+
+        WHEN( "The file is requested" )
+        {
+            QNetworkReply* reply = manager.get(QNetworkRequest(QUrl("http://localhost:8091/static/hello.txt")));
+
+            REQUIRE(testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400));
+            REQUIRE(reply->header(QNetworkRequest::ContentTypeHeader).toString() == "text/plain");
+            REQUIRE(reply->readAll() == "hello static");
+        }
+
+        WHEN( "A range is requested" )
+        {
+            QNetworkRequest request(QUrl("http://localhost:8091/static/hello.txt"));
+            request.setRawHeader("Range", "bytes=6-");
+            QNetworkReply* reply = manager.get(request);
+
+            REQUIRE(testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400));
+            REQUIRE(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 206);
+            REQUIRE(reply->rawHeader("Content-Range") == "bytes 6-11/12");
+            REQUIRE(reply->readAll() == "static");
+        }
+
+        WHEN( "A missing file is requested" )
+        {
+            QNetworkReply* reply = manager.get(QNetworkRequest(QUrl("http://localhost:8091/static/missing.txt")));
+
+            REQUIRE(testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400));
+            REQUIRE(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 404);
+            REQUIRE(reply->readAll() == "custom 404");
+        }
+    }
+}
+
+SCENARIO( "Responses are counted per route", "[QWebService]" ) {
+
+    GIVEN( "A service with metrics" )
+    {
+        QNetworkAccessManager manager;
+
+        QSharedPointer<QWebService> service = QSharedPointer<QWebService> (QWebServiceConfig()
+                .get("/users/:id", [](QSharedPointer<QWebRequest>, QSharedPointer<QWebResponse> resp) {
+                    resp->writeText("user");
+                })
+                .metrics()
+                .build());
+
+        service->startService(QHostAddress::LocalHost, 8092);
+
+        WHEN( "A route was requested" )
+        {
+            manager.get(QNetworkRequest(QUrl("http://localhost:8092/users/42")));
+            REQUIRE(testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400));
+
+            QNetworkReply* reply = manager.get(QNetworkRequest(QUrl("http://localhost:8092/metrics")));
+            REQUIRE(testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400));
+
+            THEN( "It is listed under the route, not the path" )
+            {
+                const QByteArray text = reply->readAll();
+                REQUIRE(reply->header(QNetworkRequest::ContentTypeHeader).toString().startsWith("text/plain"));
+                REQUIRE(text.contains("qwebservice_responses_total{method=\"GET\",route=\"/users/:id\",code=\"200\"} 1\n"));
+                REQUIRE_FALSE(text.contains("/users/42"));
+            }
+        }
+    }
+}
+
+SCENARIO( "Cached static files are sent precompressed", "[QWebService]" ) {
+
+    GIVEN( "A directory with a file and its .gz sibling" )
+    {
+        QNetworkAccessManager manager;
+
+        QTemporaryDir dir;
+        REQUIRE(dir.isValid());
+
+        QFile file(dir.path() + "/site.css");
+        REQUIRE(file.open(QIODevice::WriteOnly));
+        file.write("body { color: red; }");
+        file.close();
+
+        // the contents are sent as they are, they need not be valid gzip
+        QFile gzipped(dir.path() + "/site.css.gz");
+        REQUIRE(gzipped.open(QIODevice::WriteOnly));
+        gzipped.write("gzipped");
+        gzipped.close();
+
+        QSharedPointer<QWebService> service = QSharedPointer<QWebService> (QWebServiceConfig()
+                .serveDirectory("/static", dir.path())
+                .precompressed()
+                .build());
+
+        service->startService(QHostAddress::LocalHost, 8093);
+
+        WHEN( "A client accepting gzip asks twice" )
+        {
+            QByteArray etag;
+
+            for (int i = 0; i < 2; ++i) {
+                QNetworkRequest request(QUrl("http://localhost:8093/static/site.css"));
+                request.setRawHeader("Accept-Encoding", "gzip");
+                QNetworkReply* reply = manager.get(request);
+
+                REQUIRE(testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400));
+                REQUIRE(reply->rawHeader("Content-Encoding") == "gzip");
+                REQUIRE(reply->rawHeader("ETag").endsWith("-gzip\""));
+                REQUIRE(reply->readAll() == "gzipped");
+
+                etag = reply->rawHeader("ETag");
+            }
+
+            THEN( "A client without gzip gets the file under another tag" )
+            {
+                QNetworkRequest request(QUrl("http://localhost:8093/static/site.css"));
+                request.setRawHeader("Accept-Encoding", "identity");
+                QNetworkReply* reply = manager.get(request);
+
+                REQUIRE(testUtils::spinUntil(&manager, &QNetworkAccessManager::finished, 400));
+                REQUIRE(reply->rawHeader("Content-Encoding").isEmpty());
+                REQUIRE(reply->rawHeader("ETag") != etag);
+                REQUIRE(reply->readAll() == "body { color: red; }");
+            }
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#include "catch/catch.hpp"
+
+#include "router/QWebStaticFiles.h"
+
+SCENARIO( "Request paths are kept below the root", "[QWebStaticFiles]" ) {
+
+    GIVEN( "Paths below the prefix" ) {
+
+        THEN( "Empty and `.` levels are dropped" ) {
+            REQUIRE(QWebStaticFiles::normalize("/css//site.css") == "css/site.css");
+            REQUIRE(QWebStaticFiles::normalize("/./a/./b/") == "a/b");
+            REQUIRE(QWebStaticFiles::normalize("/") == "");
+            REQUIRE_FALSE(QWebStaticFiles::normalize("/").isNull());
+        }
+
+        THEN( "Paths leaving the root are refused" ) {
+            REQUIRE(QWebStaticFiles::normalize("/../etc/passwd").isNull());
+            REQUIRE(QWebStaticFiles::normalize("/a/../../b").isNull());
+            REQUIRE(QWebStaticFiles::normalize("/a\\..\\b").isNull());
+        }
+    }
+}
+
+SCENARIO( "Range headers are read", "[QWebStaticFiles]" ) {
+
+    GIVEN( "A body of 100 bytes" ) {
+        qint64 offset = -1;
+        qint64 length = -1;
+
+        THEN( "Single ranges are satisfied" ) {
+            REQUIRE(QWebStaticFiles::parseRange("bytes=0-9", 100, &offset, &length) == 1);
+            REQUIRE(offset == 0);
+            REQUIRE(length == 10);
+
+            REQUIRE(QWebStaticFiles::parseRange("bytes=90-", 100, &offset, &length) == 1);
+            REQUIRE(offset == 90);
+            REQUIRE(length == 10);
+
+            REQUIRE(QWebStaticFiles::parseRange("bytes=-5", 100, &offset, &length) == 1);
+            REQUIRE(offset == 95);
+            REQUIRE(length == 5);
+
+            REQUIRE(QWebStaticFiles::parseRange("bytes=50-500", 100, &offset, &length) == 1);
+            REQUIRE(length == 50);
+        }
+
+        THEN( "Ranges past the end can not be satisfied" ) {
+            REQUIRE(QWebStaticFiles::parseRange("bytes=100-", 100, &offset, &length) == -1);
+            REQUIRE(QWebStaticFiles::parseRange("bytes=-0", 100, &offset, &length) == -1);
+        }
+
+        THEN( "Other ranges are ignored" ) {
+            REQUIRE(QWebStaticFiles::parseRange("bytes=0-1,5-6", 100, &offset, &length) == 0);
+            REQUIRE(QWebStaticFiles::parseRange("items=0-1", 100, &offset, &length) == 0);
+            REQUIRE(QWebStaticFiles::parseRange("bytes=a-b", 100, &offset, &length) == 0);
+        }
+    }
+}
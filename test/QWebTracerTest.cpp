@@ -0,0 +1,105 @@
+#include "catch/catch.hpp"
+
+#include "QWebService.h"
+#include "router/QWebTracer.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QScopedPointer>
+#include <QTemporaryDir>
+#include <QThread>
+
+SCENARIO( "Traces are written as Chrome trace events", "[QWebTracer]" ) {
+
+    GIVEN( "A tracer writing to a file" ) {
+        QTemporaryDir dir;
+        REQUIRE(dir.isValid());
+
+        QWebTracer::Settings settings;
+        settings.fileName = dir.path() + "/trace.json";
+
+        QWebTracer::Ptr tracer(new QWebTracer(settings));
+
+        WHEN( "A request with a route and a handler phase finishes" ) {
+            QWebTrace trace(tracer);
+            trace.method = QWebService::HttpMethod::HTTP_GET;
+            trace.route = "/users/:id";
+            trace.path = "/users/42";
+            trace.mark(QWebTrace::ROUTE, 1000, 3000);
+            trace.mark(QWebTrace::HANDLER, 3000, 10000);
+
+            THEN( "The request spans its phases" ) {
+                const QByteArray events = QWebTracer::events(trace, 200, 7);
+                const QJsonArray array = QJsonDocument::fromJson("[" + events + "]").array();
+
+                REQUIRE(array.size() == 3);
+
+                const QJsonObject request = array[0].toObject();
+                REQUIRE(request["name"].toString() == "GET /users/:id");
+                REQUIRE(request["ph"].toString() == "X");
+                REQUIRE(request["ts"].toDouble() == 1.0);
+                REQUIRE(request["dur"].toDouble() == 9.0);
+                REQUIRE(request["tid"].toInt() == 7);
+                REQUIRE(request["args"].toObject()["status"].toInt() == 200);
+
+                REQUIRE(array[1].toObject()["name"].toString() == "route");
+                REQUIRE(array[2].toObject()["name"].toString() == "handler");
+                REQUIRE(array[2].toObject()["dur"].toDouble() == 7.0);
+            }
+        }
+
+        WHEN( "Requests finish and the tracer is deleted" ) {
+            {
+                // every trace keeps its tracer alive
+                QWebTrace trace(tracer);
+                trace.mark(QWebTrace::ROUTE, 1000, 3000);
+
+                tracer->finish(trace, 200);
+                tracer->finish(trace, 404);
+            }
+
+            tracer.clear();
+
+            THEN( "The file is a JSON array" ) {
+                QFile file(settings.fileName);
+                REQUIRE(file.open(QIODevice::ReadOnly));
+
+                QJsonParseError error;
+                const QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &error);
+                REQUIRE(error.error == QJsonParseError::NoError);
+                REQUIRE(doc.array().size() == 4);
+            }
+        }
+
+        WHEN( "A request finishes and the flush interval passes" ) {
+            {
+                QWebTrace trace(tracer);
+                trace.mark(QWebTrace::ROUTE, 1000, 3000);
+
+                tracer->finish(trace, 200);
+
+                // nothing was recorded, it is left out
+                tracer->finish(QWebTrace(tracer), 200);
+            }
+
+            QFile file(settings.fileName);
+            QByteArray written;
+            for (int i = 0; i < 100 && !written.contains("route"); ++i) {
+                QThread::msleep(10);
+
+                REQUIRE(file.open(QIODevice::ReadOnly));
+                written = file.readAll();
+                file.close();
+            }
+
+            THEN( "The events are written while the tracer is alive" ) {
+                QJsonParseError error;
+                const QJsonDocument doc = QJsonDocument::fromJson(written + "]", &error);
+                REQUIRE(error.error == QJsonParseError::NoError);
+                REQUIRE(doc.array().size() == 2);
+            }
+        }
+    }
+}